@@ -9,12 +9,26 @@ void ble_init()
 }
 bool ble_uart_connected() { return false; }
 size_t ble_uart_write(const uint8_t* /*data*/, size_t /*len*/) { return 0; }
+void ble_uart_set_rx_callback(ble_uart_rx_fn /*cb*/) {}
 
 #else
 
 #include <cstring>
 #include <cstdio>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "sdkconfig.h"
+#include "bridge_config.h"
+#include "mem_report.h"
+
+// The pools are configured in sdkconfig; catch an env file that drifted from the intended sizes
+static_assert(CONFIG_BT_NIMBLE_MSYS_1_BLOCK_COUNT == BRIDGE_NIMBLE_MSYS_1_COUNT &&
+                  CONFIG_BT_NIMBLE_MSYS_1_BLOCK_SIZE == BRIDGE_NIMBLE_MSYS_1_SIZE,
+              "CONFIG_BT_NIMBLE_MSYS_1_* differs from BRIDGE_NIMBLE_MSYS_1_* in bridge_config.h");
+static_assert(CONFIG_BT_NIMBLE_MSYS_2_BLOCK_COUNT == BRIDGE_NIMBLE_MSYS_2_COUNT &&
+                  CONFIG_BT_NIMBLE_MSYS_2_BLOCK_SIZE == BRIDGE_NIMBLE_MSYS_2_SIZE,
+              "CONFIG_BT_NIMBLE_MSYS_2_* differs from BRIDGE_NIMBLE_MSYS_2_* in bridge_config.h");
 
 // NimBLE (ESP-IDF)
 // Support both include layouts (IDF component vs upstream layout)
@@ -44,7 +58,18 @@ size_t ble_uart_write(const uint8_t* /*data*/, size_t /*len*/) { return 0; }
 
 static const char* TAG = "ble_uart";
 
+// NimBLE host task with a static stack. Same stack size, priority and core as
+// nimble_port_freertos_init(), which would allocate them from the heap.
+#if defined(CONFIG_FREERTOS_UNICORE) || !defined(CONFIG_BT_NIMBLE_PINNED_TO_CORE)
+#define NIMBLE_HOST_CORE 0
+#else
+#define NIMBLE_HOST_CORE CONFIG_BT_NIMBLE_PINNED_TO_CORE
+#endif
+static StaticTask_t s_host_tcb;
+static StackType_t s_host_stack[CONFIG_BT_NIMBLE_HOST_TASK_STACK_SIZE];
+
 static uint16_t s_conn_handle = 0xFFFF;
+static ble_uart_rx_fn s_rx_cb = nullptr;
 static uint16_t s_tx_val_handle = 0; // attribute handle for TX characteristic value
 static bool s_tx_notify_enabled = false;
 // Dynamic device name buffer, updated after BLE address is known
@@ -68,9 +93,14 @@ static int gatt_rw_access_cb(uint16_t conn_handle, uint16_t attr_handle, struct
     (void)arg;
     if (ctxt->op == BLE_GATT_ACCESS_OP_WRITE_CHR)
     {
-        // Received data from central to RX characteristic; ignore contents for now.
+        // Received data from central to RX characteristic
         ESP_LOGD(TAG, "RX write, len=%d", (int)OS_MBUF_PKTLEN(ctxt->om));
-        // Could parse here if needed.
+        ble_uart_rx_fn cb = s_rx_cb;
+        // Hand over each segment of the mbuf chain; no copy needed
+        for (struct os_mbuf* om = ctxt->om; cb && om; om = SLIST_NEXT(om, om_next))
+        {
+            cb(om->om_data, om->om_len);
+        }
         return 0;
     }
     else if (ctxt->op == BLE_GATT_ACCESS_OP_READ_CHR)
@@ -243,7 +273,7 @@ static void host_task(void* param)
 {
     (void)param;
     nimble_port_run();
-    nimble_port_freertos_deinit();
+    vTaskDelete(nullptr);
 }
 
 void ble_init()
@@ -301,7 +331,13 @@ void ble_init()
 
     ble_hs_cfg.sync_cb = on_sync;
 
-    nimble_port_freertos_init(host_task);
+    TaskHandle_t task = xTaskCreateStaticPinnedToCore(host_task, "nimble_host", sizeof(s_host_stack), nullptr,
+                                                      configMAX_PRIORITIES - 4, s_host_stack, &s_host_tcb,
+                                                      NIMBLE_HOST_CORE);
+    mem_report_static("nimble_host_task", sizeof(s_host_stack) + sizeof(s_host_tcb));
+    mem_report_pool("nimble_msys1", CONFIG_BT_NIMBLE_MSYS_1_BLOCK_COUNT, CONFIG_BT_NIMBLE_MSYS_1_BLOCK_SIZE);
+    mem_report_pool("nimble_msys2", CONFIG_BT_NIMBLE_MSYS_2_BLOCK_COUNT, CONFIG_BT_NIMBLE_MSYS_2_BLOCK_SIZE);
+    mem_report_task(task, sizeof(s_host_stack));
 }
 
 bool ble_uart_connected()
@@ -309,6 +345,11 @@ bool ble_uart_connected()
     return s_conn_handle != 0xFFFF && s_tx_notify_enabled;
 }
 
+void ble_uart_set_rx_callback(ble_uart_rx_fn cb)
+{
+    s_rx_cb = cb;
+}
+
 size_t ble_uart_write(const uint8_t* data, size_t len)
 {
     if (!data || len == 0) return 0;
@@ -17,3 +17,10 @@ bool ble_uart_connected();
 // Send bytes over BLE UART TX as notification (if ENABLE_BLE).
 // Returns number of bytes queued/sent, or 0 on failure or when BLE disabled.
 size_t ble_uart_write(const uint8_t* data, size_t len);
+
+// Bytes written by the central to the BLE UART RX characteristic (if ENABLE_BLE).
+// Called from the NimBLE host task.
+typedef void (*ble_uart_rx_fn)(const uint8_t* data, size_t len);
+
+// Register the receive callback; nullptr ignores received data.
+void ble_uart_set_rx_callback(ble_uart_rx_fn cb);
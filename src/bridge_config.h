@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+/*
+ * Scheduling layout and hot-path placement, from Kconfig (menu "CAN-to-SLCAN bridge").
+ * Every value can also be overridden with a build flag, e.g. -DBRIDGE_CAN_CORE=0.
+ * A core of -1 means no affinity.
+ **/
+
+#ifndef BRIDGE_CAN_CORE
+#if defined(CONFIG_BRIDGE_LAYOUT_SPLIT) && !defined(CONFIG_FREERTOS_UNICORE)
+#define BRIDGE_CAN_CORE CONFIG_BRIDGE_CAN_CORE
+#else
+#define BRIDGE_CAN_CORE (-1)
+#endif
+#endif
+
+// TinyUSB always had a fixed core; in the split layout it takes the other one
+#ifndef BRIDGE_USB_CORE
+#if BRIDGE_CAN_CORE >= 0
+#define BRIDGE_USB_CORE (1 - BRIDGE_CAN_CORE)
+#else
+#define BRIDGE_USB_CORE 0
+#endif
+#endif
+
+#ifndef BRIDGE_LAYOUT_NAME
+#if BRIDGE_CAN_CORE >= 0
+#define BRIDGE_LAYOUT_NAME "split"
+#else
+#define BRIDGE_LAYOUT_NAME "unpinned"
+#endif
+#endif
+
+// The split layout relies on the TWAI ISR staying live while the flash cache is off
+#if BRIDGE_CAN_CORE >= 0 && !defined(CONFIG_TWAI_ISR_IN_IRAM)
+#warning "Split layout without CONFIG_TWAI_ISR_IN_IRAM: the TWAI ISR is not IRAM-safe (check sdkconfig.<env>)"
+#endif
+
+#ifndef BRIDGE_TASK_PRIORITY
+#ifdef CONFIG_BRIDGE_TASK_PRIORITY
+#define BRIDGE_TASK_PRIORITY CONFIG_BRIDGE_TASK_PRIORITY
+#else
+#define BRIDGE_TASK_PRIORITY 5
+#endif
+#endif
+
+// Functions on the per-frame path
+#ifndef BRIDGE_HOT
+#ifdef CONFIG_BRIDGE_HOT_PATH_IN_IRAM
+#define BRIDGE_HOT IRAM_ATTR
+#else
+#define BRIDGE_HOT
+#endif
+#endif
+
+// Per-frame latency tracing (trace.h)
+#ifndef BRIDGE_TRACE
+#ifdef CONFIG_BRIDGE_TRACE
+#define BRIDGE_TRACE 1
+#else
+#define BRIDGE_TRACE 0
+#endif
+#endif
+
+#ifndef BRIDGE_TRACE_RING_LEN
+#ifdef CONFIG_BRIDGE_TRACE_RING_LEN
+#define BRIDGE_TRACE_RING_LEN CONFIG_BRIDGE_TRACE_RING_LEN
+#else
+#define BRIDGE_TRACE_RING_LEN 256
+#endif
+#endif
+
+#if BRIDGE_TRACE && BRIDGE_CAN_CORE < 0
+#warning "BRIDGE_TRACE needs a pinned bridge task: per-core cycle counters are not synchronized"
+#endif
+
+#define BRIDGE_CORE_AFFINITY(core) ((core) < 0 ? tskNO_AFFINITY : (BaseType_t)(core))
+
+/*
+ * Memory budget. Every queue, buffer and task stack owned by the bridge is sized
+ * here and allocated statically; mem_report.h prints the result at boot.
+ **/
+
+#ifndef BRIDGE_BITRATE
+#ifdef CONFIG_BRIDGE_BITRATE
+#define BRIDGE_BITRATE CONFIG_BRIDGE_BITRATE
+#else
+#define BRIDGE_BITRATE 500000
+#endif
+#endif
+
+#if BRIDGE_BITRATE == 1000000
+#define BRIDGE_TWAI_TIMING TWAI_TIMING_CONFIG_1MBITS()
+#elif BRIDGE_BITRATE == 500000
+#define BRIDGE_TWAI_TIMING TWAI_TIMING_CONFIG_500KBITS()
+#elif BRIDGE_BITRATE == 250000
+#define BRIDGE_TWAI_TIMING TWAI_TIMING_CONFIG_250KBITS()
+#elif BRIDGE_BITRATE == 125000
+#define BRIDGE_TWAI_TIMING TWAI_TIMING_CONFIG_125KBITS()
+#else
+#error "BRIDGE_BITRATE must be one of 125000, 250000, 500000, 1000000"
+#endif
+
+#ifndef BRIDGE_RX_BUFFER_MS
+#ifdef CONFIG_BRIDGE_RX_BUFFER_MS
+#define BRIDGE_RX_BUFFER_MS CONFIG_BRIDGE_RX_BUFFER_MS
+#else
+#define BRIDGE_RX_BUFFER_MS 25
+#endif
+#endif
+
+// Shortest standard frame incl. interframe space, without stuff bits
+#define BRIDGE_MIN_FRAME_BITS 47
+#define BRIDGE_MAX_FRAMES_PER_S (BRIDGE_BITRATE / BRIDGE_MIN_FRAME_BITS)
+
+// Rounded up to a multiple of 16 entries
+#ifndef BRIDGE_TWAI_RX_QUEUE_LEN
+#define BRIDGE_TWAI_RX_QUEUE_LEN ((BRIDGE_MAX_FRAMES_PER_S * BRIDGE_RX_BUFFER_MS / 1000 + 15) / 16 * 16)
+#endif
+
+#ifndef BRIDGE_TWAI_TX_QUEUE_LEN
+#define BRIDGE_TWAI_TX_QUEUE_LEN 16
+#endif
+
+// Frames waiting for the gs_usb bulk IN endpoint (RX frames and TX echoes)
+#ifndef BRIDGE_GS_USB_IN_QUEUE_LEN
+#define BRIDGE_GS_USB_IN_QUEUE_LEN 64
+#endif
+
+// Self-test injection queue; holds more than one generator burst (one tick at 1 Mbit/s)
+#ifndef BRIDGE_SELFTEST_QUEUE_LEN
+#define BRIDGE_SELFTEST_QUEUE_LEN 256
+#endif
+
+// NimBLE mbuf pools of the BLE builds. NimBLE allocates them from the heap using
+// its sdkconfig values; ble.cpp rejects a configuration that differs from these.
+// One SLCAN notification takes one MSYS_1 block, so 128 blocks buffer ~128 frames
+// while the link is congested: ~37 KiB + ~16 KiB internal RAM, ~42 KiB more than
+// the IDF defaults (12 x 256 and 24 x 320).
+#ifndef BRIDGE_NIMBLE_MSYS_1_COUNT
+#define BRIDGE_NIMBLE_MSYS_1_COUNT 128
+#endif
+#ifndef BRIDGE_NIMBLE_MSYS_1_SIZE
+#define BRIDGE_NIMBLE_MSYS_1_SIZE 292
+#endif
+#ifndef BRIDGE_NIMBLE_MSYS_2_COUNT
+#define BRIDGE_NIMBLE_MSYS_2_COUNT 24
+#endif
+#ifndef BRIDGE_NIMBLE_MSYS_2_SIZE
+#define BRIDGE_NIMBLE_MSYS_2_SIZE 660
+#endif
+
+// Task stacks in bytes
+#ifndef BRIDGE_TASK_STACK
+#ifdef CONFIG_BRIDGE_TASK_STACK
+#define BRIDGE_TASK_STACK CONFIG_BRIDGE_TASK_STACK
+#else
+#define BRIDGE_TASK_STACK 4096
+#endif
+#endif
+
+#ifndef BRIDGE_USB_TASK_STACK
+#ifdef CONFIG_BRIDGE_USB_TASK_STACK
+#define BRIDGE_USB_TASK_STACK CONFIG_BRIDGE_USB_TASK_STACK
+#else
+#define BRIDGE_USB_TASK_STACK 4096
+#endif
+#endif
+
+#ifndef BRIDGE_SELFTEST_STACK
+#define BRIDGE_SELFTEST_STACK 3072
+#endif
+
+#ifndef BRIDGE_TRACE_STACK
+#define BRIDGE_TRACE_STACK 3072
+#endif
+
+#ifndef BRIDGE_VENDOR_CMD_STACK
+#define BRIDGE_VENDOR_CMD_STACK 3072
+#endif
@@ -0,0 +1,429 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#include "gs_usb.h"
+
+#ifndef ENABLE_GS_USB
+
+// No-op implementations when gs_usb mode is disabled
+void gs_usb_configure(tinyusb_config_t& /*cfg*/, uint32_t /*bitrate*/)
+{
+}
+bool gs_usb_started() { return false; }
+bool gs_usb_write(const twai_message_t& /*msg*/) { return false; }
+
+#else
+
+#include <cstdio>
+#include <cstring>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "gs_usb_frame.h"
+#include "bridge_config.h"
+#include "mem_report.h"
+
+static const char* TAG = "gs_usb";
+
+// candleLight VID/PID, matched by the Linux gs_usb driver
+#define GS_USB_VID 0x1D50
+#define GS_USB_PID 0x606F
+
+#define GS_USB_EP_OUT 0x02
+#define GS_USB_EP_IN 0x81
+#define GS_USB_EP_SIZE 64
+
+// TWAI on ESP32-S3 is clocked from the 80 MHz APB clock
+#define GS_USB_FCLK_CAN 80000000
+
+enum
+{
+    STRID_LANGID = 0,
+    STRID_MANUFACTURER,
+    STRID_PRODUCT,
+    STRID_SERIAL,
+    STRID_INTERFACE,
+    STRID_COUNT
+};
+
+static const tusb_desc_device_t s_device_desc = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = 0x00,
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = GS_USB_VID,
+    .idProduct = GS_USB_PID,
+    .bcdDevice = 0x0100,
+    .iManufacturer = STRID_MANUFACTURER,
+    .iProduct = STRID_PRODUCT,
+    .iSerialNumber = STRID_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+#define GS_USB_CONFIG_TOTAL_LEN (TUD_CONFIG_DESC_LEN + TUD_VENDOR_DESC_LEN)
+
+static const uint8_t s_config_desc[] = {
+    TUD_CONFIG_DESCRIPTOR(1, 1, 0, GS_USB_CONFIG_TOTAL_LEN, 0x80, 100),
+    TUD_VENDOR_DESCRIPTOR(0, STRID_INTERFACE, GS_USB_EP_OUT, GS_USB_EP_IN, GS_USB_EP_SIZE),
+};
+
+static const char s_langid[] = {0x09, 0x04};
+// Filled from the factory MAC in gs_usb_configure() so several units on one host differ
+static char s_serial[13] = "000000000000";
+static const char* s_string_desc[STRID_COUNT] = {
+    s_langid,
+    "ubx",
+    "CAN-to-SLCAN gs_usb",
+    s_serial,
+    "gs_usb",
+};
+
+static uint32_t s_bitrate = 0;
+static uint8_t s_rhport = 0;
+static uint8_t s_ep_in = 0;
+static uint8_t s_ep_out = 0;
+static volatile bool s_started = false;
+static volatile bool s_hw_timestamp = false;
+static volatile bool s_listen_only = true;
+// Frames waiting for the bulk IN endpoint (RX frames and TX echoes)
+static StaticQueue_t s_in_queue_buf;
+static uint8_t s_in_queue_storage[BRIDGE_GS_USB_IN_QUEUE_LEN * sizeof(gs_host_frame)];
+static QueueHandle_t s_in_queue = nullptr;
+static uint32_t s_in_dropped = 0;
+// Set on every drop; the next frame put on the wire carries GS_CAN_FLAG_OVERFLOW, as in candleLight_fw
+static volatile bool s_in_overflow = false;
+static uint32_t s_tx_failed = 0;
+
+CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static gs_host_frame s_in_frame;
+CFG_TUSB_MEM_SECTION CFG_TUSB_MEM_ALIGN static uint8_t s_out_buf[GS_USB_EP_SIZE];
+CFG_TUSB_MEM_ALIGN static uint8_t s_ctrl_buf[sizeof(gs_device_bt_const)];
+
+static uint32_t timestamp_us()
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+// Start the next IN transfer if the endpoint is idle. Safe to call from both the
+// bridge task and the TinyUSB task: the endpoint claim serializes the callers,
+// and the queue is re-checked after releasing so no frame is left stranded.
+static void in_pump()
+{
+    while (uxQueueMessagesWaiting(s_in_queue) > 0)
+    {
+        if (!tud_mounted() || !usbd_edpt_claim(s_rhport, s_ep_in)) return;
+        if (xQueueReceive(s_in_queue, &s_in_frame, 0) == pdTRUE)
+        {
+            uint16_t len = s_hw_timestamp ? GS_HOST_FRAME_SIZE_TS : GS_HOST_FRAME_SIZE;
+            bool overflow = s_in_overflow;
+            if (overflow) gs_usb_mark_overflow(&s_in_frame);
+            if (usbd_edpt_xfer(s_rhport, s_ep_in, reinterpret_cast<uint8_t*>(&s_in_frame), len))
+            {
+                if (overflow) s_in_overflow = false;
+                return;
+            }
+            s_in_dropped++;
+            s_in_overflow = true;
+        }
+        usbd_edpt_release(s_rhport, s_ep_in);
+    }
+}
+
+static bool in_enqueue(const gs_host_frame& frame)
+{
+    if (xQueueSend(s_in_queue, &frame, 0) != pdTRUE)
+    {
+        s_in_dropped++;
+        s_in_overflow = true;
+        return false;
+    }
+    in_pump();
+    return true;
+}
+
+static void out_arm()
+{
+    usbd_edpt_xfer(s_rhport, s_ep_out, s_out_buf, sizeof(s_out_buf));
+}
+
+// Host -> CAN: transmit and echo the frame back so the host releases its TX context.
+// Frames are only put on the bus when built with GS_USB_ENABLE_TX and the host did
+// not start the channel in listen-only mode; otherwise they are dropped unechoed.
+static void handle_host_frame(const uint8_t* buf, uint32_t len)
+{
+    if (len < GS_HOST_FRAME_SIZE || !s_started) return;
+#ifndef GS_USB_ENABLE_TX
+    s_tx_failed++;
+    return;
+#else
+    if (s_listen_only)
+    {
+        s_tx_failed++;
+        return;
+    }
+
+    gs_host_frame hf = {};
+    std::memcpy(&hf, buf, GS_HOST_FRAME_SIZE);
+
+    twai_message_t msg = {};
+    msg.extd = (hf.can_id & GS_CAN_EFF_FLAG) ? 1 : 0;
+    msg.rtr = (hf.can_id & GS_CAN_RTR_FLAG) ? 1 : 0;
+    msg.identifier = hf.can_id & (msg.extd ? GS_CAN_EFF_MASK : GS_CAN_SFF_MASK);
+    msg.data_length_code = hf.can_dlc > 8 ? 8 : hf.can_dlc;
+    std::memcpy(msg.data, hf.data, msg.data_length_code);
+
+    // Never block the TinyUSB task. Only frames accepted by the driver are echoed,
+    // so the host does not report a frame as sent that never reached the bus.
+    if (twai_transmit(&msg, 0) != ESP_OK)
+    {
+        s_tx_failed++;
+        return;
+    }
+
+    gs_host_frame echo;
+    gs_usb_pack_frame(&echo, hf.echo_id, hf.can_id, hf.can_dlc, hf.data, timestamp_us(), s_hw_timestamp);
+    in_enqueue(echo);
+#endif
+}
+
+static bool bittiming_matches(const gs_device_bittiming& bt)
+{
+    uint32_t tq = 1 + bt.prop_seg + bt.phase_seg1 + bt.phase_seg2;
+    if (bt.brp == 0 || tq == 0) return false;
+    uint32_t bitrate = GS_USB_FCLK_CAN / (bt.brp * tq);
+    if (bitrate != s_bitrate)
+    {
+        ESP_LOGW(TAG, "Host requested %u bit/s, bus is fixed at %u bit/s", (unsigned)bitrate, (unsigned)s_bitrate);
+        return false;
+    }
+    return true;
+}
+
+// Requests addressed to a CAN channel carry its number in wValue. HOST_FORMAT and
+// DEVICE_CONFIG are device-wide; Linux sends them with wValue=1, so wValue is ignored.
+static bool is_channel_request(uint8_t breq)
+{
+    switch (breq)
+    {
+    case GS_USB_BREQ_BITTIMING:
+    case GS_USB_BREQ_MODE:
+    case GS_USB_BREQ_BT_CONST:
+    case GS_USB_BREQ_TIMESTAMP:
+    case GS_USB_BREQ_IDENTIFY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const* request)
+{
+    if (request->bmRequestType_bit.recipient != TUSB_REQ_RCPT_INTERFACE) return false;
+    if (is_channel_request(request->bRequest) && request->wValue != 0) return false; // single channel
+
+    if (stage == CONTROL_STAGE_SETUP)
+    {
+        switch (request->bRequest)
+        {
+        case GS_USB_BREQ_BT_CONST:
+            {
+                gs_device_bt_const bt = {};
+                bt.feature = GS_CAN_FEATURE_HW_TIMESTAMP | GS_CAN_FEATURE_LISTEN_ONLY;
+                bt.fclk_can = GS_USB_FCLK_CAN;
+                bt.tseg1_min = 1;
+                bt.tseg1_max = 16;
+                bt.tseg2_min = 1;
+                bt.tseg2_max = 8;
+                bt.sjw_max = 4;
+                bt.brp_min = 2;
+                bt.brp_max = 128;
+                bt.brp_inc = 2;
+                std::memcpy(s_ctrl_buf, &bt, sizeof(bt));
+                return tud_control_xfer(rhport, request, s_ctrl_buf, sizeof(bt));
+            }
+        case GS_USB_BREQ_DEVICE_CONFIG:
+            {
+                gs_device_config dc = {};
+                dc.icount = 0;
+                dc.sw_version = 2;
+                dc.hw_version = 1;
+                std::memcpy(s_ctrl_buf, &dc, sizeof(dc));
+                return tud_control_xfer(rhport, request, s_ctrl_buf, sizeof(dc));
+            }
+        case GS_USB_BREQ_TIMESTAMP:
+            {
+                uint32_t ts = timestamp_us();
+                std::memcpy(s_ctrl_buf, &ts, sizeof(ts));
+                return tud_control_xfer(rhport, request, s_ctrl_buf, sizeof(ts));
+            }
+        case GS_USB_BREQ_HOST_FORMAT:
+        case GS_USB_BREQ_BITTIMING:
+        case GS_USB_BREQ_MODE:
+        case GS_USB_BREQ_IDENTIFY:
+            if (request->wLength > sizeof(s_ctrl_buf)) return false;
+            return tud_control_xfer(rhport, request, s_ctrl_buf, request->wLength);
+        default:
+            return false;
+        }
+    }
+
+    if (stage == CONTROL_STAGE_DATA && request->bmRequestType_bit.direction == TUSB_DIR_OUT)
+    {
+        switch (request->bRequest)
+        {
+        case GS_USB_BREQ_BITTIMING:
+            {
+                if (request->wLength < sizeof(gs_device_bittiming)) return false;
+                gs_device_bittiming bt;
+                std::memcpy(&bt, s_ctrl_buf, sizeof(bt));
+                return bittiming_matches(bt);
+            }
+        case GS_USB_BREQ_MODE:
+            {
+                if (request->wLength < sizeof(gs_device_mode)) return false;
+                gs_device_mode mode;
+                std::memcpy(&mode, s_ctrl_buf, sizeof(mode));
+                if (mode.mode == GS_CAN_MODE_START)
+                {
+                    s_listen_only = (mode.flags & GS_CAN_FEATURE_LISTEN_ONLY) != 0;
+#ifndef GS_USB_ENABLE_TX
+                    if (!s_listen_only)
+                    {
+                        ESP_LOGW(TAG, "Host TX is disabled in this build; start the channel with listen-only on");
+                        return false;
+                    }
+#endif
+                    s_hw_timestamp = (mode.flags & GS_CAN_FEATURE_HW_TIMESTAMP) != 0;
+                    xQueueReset(s_in_queue);
+                    s_started = true;
+                    ESP_LOGI(TAG, "Channel started (hw_timestamp=%d listen_only=%d)", s_hw_timestamp ? 1 : 0,
+                             s_listen_only ? 1 : 0);
+                }
+                else
+                {
+                    s_started = false;
+                    ESP_LOGI(TAG, "Channel reset (in_dropped=%u tx_failed=%u)",
+                             (unsigned)s_in_dropped, (unsigned)s_tx_failed);
+                }
+                return true;
+            }
+        default:
+            return true;
+        }
+    }
+    return true;
+}
+
+// Minimal application class driver owning the vendor interface and its bulk endpoints
+static void gsusb_driver_init()
+{
+}
+
+static void gsusb_driver_reset(uint8_t /*rhport*/)
+{
+    s_started = false;
+    s_ep_in = 0;
+    s_ep_out = 0;
+}
+
+static uint16_t gsusb_driver_open(uint8_t rhport, tusb_desc_interface_t const* itf, uint16_t max_len)
+{
+    TU_VERIFY(itf->bInterfaceClass == TUSB_CLASS_VENDOR_SPECIFIC, 0);
+    uint16_t const drv_len = (uint16_t)(sizeof(tusb_desc_interface_t) +
+        itf->bNumEndpoints * sizeof(tusb_desc_endpoint_t));
+    TU_VERIFY(max_len >= drv_len, 0);
+
+    TU_ASSERT(usbd_open_edpt_pair(rhport, tu_desc_next(itf), 2, TUSB_XFER_BULK, &s_ep_out, &s_ep_in), 0);
+    s_rhport = rhport;
+    out_arm();
+    return drv_len;
+}
+
+static bool gsusb_driver_control_xfer_cb(uint8_t /*rhport*/, uint8_t /*stage*/,
+                                         tusb_control_request_t const* /*request*/)
+{
+    // Vendor requests are routed to tud_vendor_control_xfer_cb()
+    return false;
+}
+
+static bool gsusb_driver_xfer_cb(uint8_t /*rhport*/, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes)
+{
+    if (ep_addr == s_ep_out)
+    {
+        if (result == XFER_RESULT_SUCCESS) handle_host_frame(s_out_buf, xferred_bytes);
+        out_arm();
+    }
+    else if (ep_addr == s_ep_in)
+    {
+        if (result != XFER_RESULT_SUCCESS)
+        {
+            s_in_dropped++;
+            s_in_overflow = true;
+        }
+        in_pump();
+    }
+    return true;
+}
+
+static usbd_class_driver_t s_driver = {};
+
+usbd_class_driver_t const* usbd_app_driver_get_cb(uint8_t* driver_count)
+{
+    *driver_count = 1;
+    return &s_driver;
+}
+
+void gs_usb_configure(tinyusb_config_t& cfg, uint32_t bitrate)
+{
+    s_bitrate = bitrate;
+
+    uint8_t mac[6] = {};
+    if (esp_efuse_mac_get_default(mac) == ESP_OK)
+    {
+        std::snprintf(s_serial, sizeof(s_serial), "%02X%02X%02X%02X%02X%02X", mac[0], mac[1], mac[2], mac[3], mac[4],
+                      mac[5]);
+    }
+    s_in_queue = xQueueCreateStatic(BRIDGE_GS_USB_IN_QUEUE_LEN, sizeof(gs_host_frame), s_in_queue_storage,
+                                    &s_in_queue_buf);
+    mem_report_static("gs_usb_in_queue", sizeof(s_in_queue_storage) + sizeof(s_in_queue_buf));
+
+    // Assigned field by field: the struct layout differs between TinyUSB versions
+#if CFG_TUSB_DEBUG >= 2
+    s_driver.name = "GS_USB";
+#endif
+    s_driver.init = gsusb_driver_init;
+    s_driver.reset = gsusb_driver_reset;
+    s_driver.open = gsusb_driver_open;
+    s_driver.control_xfer_cb = gsusb_driver_control_xfer_cb;
+    s_driver.xfer_cb = gsusb_driver_xfer_cb;
+    s_driver.sof = nullptr;
+
+    cfg.descriptor.device = &s_device_desc;
+    cfg.descriptor.string = s_string_desc;
+    cfg.descriptor.string_count = STRID_COUNT;
+    cfg.descriptor.full_speed_config = s_config_desc;
+
+    ESP_LOGI(TAG, "gs_usb personality: VID=%04X PID=%04X, serial=%s, in_queue=%d, bitrate=%u",
+             GS_USB_VID, GS_USB_PID, s_serial, BRIDGE_GS_USB_IN_QUEUE_LEN, (unsigned)bitrate);
+}
+
+bool gs_usb_started()
+{
+    return s_started && tud_mounted();
+}
+
+bool gs_usb_write(const twai_message_t& msg)
+{
+    if (!gs_usb_started()) return false;
+
+    gs_host_frame frame;
+    gs_usb_pack_frame(&frame, GS_HOST_FRAME_ECHO_ID_RX, gs_usb_can_id(msg.identifier, msg.extd, msg.rtr),
+                      msg.data_length_code, msg.data, timestamp_us(), s_hw_timestamp);
+    return in_enqueue(frame);
+}
+
+#endif // ENABLE_GS_USB
@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "driver/twai.h"
+#include "tinyusb.h"
+
+// Optional gs_usb (candleLight) USB personality.
+// When ENABLE_GS_USB is defined the device enumerates as a candleLight adapter
+// (VID 0x1D50, PID 0x606F) instead of CDC-ACM, and Linux binds its in-kernel
+// gs_usb driver, exposing a native canX network interface.
+// This module compiles to no-ops unless ENABLE_GS_USB is defined via build flags.
+
+// Point the TinyUSB configuration at the gs_usb descriptors (if ENABLE_GS_USB).
+// Must be called before tinyusb_driver_install(). The CAN bitrate is fixed by the
+// bridge; host bit timing requests for any other bitrate are rejected.
+void gs_usb_configure(tinyusb_config_t& cfg, uint32_t bitrate);
+
+// Returns true once the host has started the CAN channel (if ENABLE_GS_USB),
+// otherwise always false.
+bool gs_usb_started();
+
+// Queue a received CAN frame for the bulk IN endpoint (if ENABLE_GS_USB).
+// Returns false when the frame was dropped (channel not started or queue full).
+bool gs_usb_write(const twai_message_t& msg);
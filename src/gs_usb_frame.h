@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * gs_usb (candleLight) wire format, as consumed by the Linux gs_usb driver
+ * (drivers/net/can/usb/gs_usb.c). All multi-byte fields are little-endian,
+ * which matches both the ESP32 and x86/ARM hosts, so the structs are used as-is.
+ *
+ * This header has no ESP-IDF dependencies so the packing can be compiled and
+ * checked on the host.
+ **/
+
+// Vendor control requests (bRequest), recipient = interface, wValue = channel
+enum GsUsbBreq : uint8_t
+{
+    GS_USB_BREQ_HOST_FORMAT = 0,
+    GS_USB_BREQ_BITTIMING = 1,
+    GS_USB_BREQ_MODE = 2,
+    GS_USB_BREQ_BERR = 3,
+    GS_USB_BREQ_BT_CONST = 4,
+    GS_USB_BREQ_DEVICE_CONFIG = 5,
+    GS_USB_BREQ_TIMESTAMP = 6,
+    GS_USB_BREQ_IDENTIFY = 7,
+};
+
+// gs_device_mode.mode
+static constexpr uint32_t GS_CAN_MODE_RESET = 0;
+static constexpr uint32_t GS_CAN_MODE_START = 1;
+
+// gs_device_mode.flags and gs_device_bt_const.feature
+static constexpr uint32_t GS_CAN_FEATURE_LISTEN_ONLY = 1u << 0;
+static constexpr uint32_t GS_CAN_FEATURE_LOOP_BACK = 1u << 1;
+static constexpr uint32_t GS_CAN_FEATURE_TRIPLE_SAMPLE = 1u << 2;
+static constexpr uint32_t GS_CAN_FEATURE_ONE_SHOT = 1u << 3;
+static constexpr uint32_t GS_CAN_FEATURE_HW_TIMESTAMP = 1u << 4;
+
+// gs_host_frame.flags
+static constexpr uint8_t GS_CAN_FLAG_OVERFLOW = 1u << 0;
+
+// gs_host_frame.echo_id for frames that did not originate from the host
+static constexpr uint32_t GS_HOST_FRAME_ECHO_ID_RX = 0xFFFFFFFFu;
+
+// Linux struct can_frame can_id flags
+static constexpr uint32_t GS_CAN_EFF_FLAG = 0x80000000u;
+static constexpr uint32_t GS_CAN_RTR_FLAG = 0x40000000u;
+static constexpr uint32_t GS_CAN_ERR_FLAG = 0x20000000u;
+static constexpr uint32_t GS_CAN_SFF_MASK = 0x000007FFu;
+static constexpr uint32_t GS_CAN_EFF_MASK = 0x1FFFFFFFu;
+
+struct gs_host_config
+{
+    uint32_t byte_order;
+};
+
+struct gs_device_config
+{
+    uint8_t reserved1;
+    uint8_t reserved2;
+    uint8_t reserved3;
+    uint8_t icount; // number of CAN channels - 1
+    uint32_t sw_version;
+    uint32_t hw_version;
+};
+
+struct gs_device_mode
+{
+    uint32_t mode;
+    uint32_t flags;
+};
+
+struct gs_device_bittiming
+{
+    uint32_t prop_seg;
+    uint32_t phase_seg1;
+    uint32_t phase_seg2;
+    uint32_t sjw;
+    uint32_t brp;
+};
+
+struct gs_identify_mode
+{
+    uint32_t mode;
+};
+
+struct gs_device_bt_const
+{
+    uint32_t feature;
+    uint32_t fclk_can;
+    uint32_t tseg1_min;
+    uint32_t tseg1_max;
+    uint32_t tseg2_min;
+    uint32_t tseg2_max;
+    uint32_t sjw_max;
+    uint32_t brp_min;
+    uint32_t brp_max;
+    uint32_t brp_inc;
+};
+
+// Classic CAN host frame; timestamp_us is only on the wire when the host
+// started the channel with GS_CAN_FEATURE_HW_TIMESTAMP.
+struct gs_host_frame
+{
+    uint32_t echo_id;
+    uint32_t can_id;
+    uint8_t can_dlc;
+    uint8_t channel;
+    uint8_t flags;
+    uint8_t reserved;
+    uint8_t data[8];
+    uint32_t timestamp_us;
+};
+
+static constexpr size_t GS_HOST_FRAME_SIZE = offsetof(gs_host_frame, timestamp_us);
+static constexpr size_t GS_HOST_FRAME_SIZE_TS = sizeof(gs_host_frame);
+
+static_assert(sizeof(gs_device_config) == 12, "gs_device_config layout");
+static_assert(sizeof(gs_device_mode) == 8, "gs_device_mode layout");
+static_assert(sizeof(gs_device_bittiming) == 20, "gs_device_bittiming layout");
+static_assert(sizeof(gs_device_bt_const) == 40, "gs_device_bt_const layout");
+static_assert(offsetof(gs_host_frame, can_id) == 4, "gs_host_frame layout");
+static_assert(offsetof(gs_host_frame, can_dlc) == 8, "gs_host_frame layout");
+static_assert(offsetof(gs_host_frame, flags) == 10, "gs_host_frame layout");
+static_assert(offsetof(gs_host_frame, data) == 12, "gs_host_frame layout");
+static_assert(GS_HOST_FRAME_SIZE == 20, "gs_host_frame classic size");
+static_assert(GS_HOST_FRAME_SIZE_TS == 24, "gs_host_frame timestamped size");
+
+// Build the Linux-style can_id (identifier plus EFF/RTR flags).
+static inline uint32_t gs_usb_can_id(uint32_t identifier, bool extd, bool rtr)
+{
+    uint32_t can_id = extd ? ((identifier & GS_CAN_EFF_MASK) | GS_CAN_EFF_FLAG) : (identifier & GS_CAN_SFF_MASK);
+    if (rtr) can_id |= GS_CAN_RTR_FLAG;
+    return can_id;
+}
+
+// Fill a host frame. Returns the number of bytes to put on the bulk IN endpoint.
+static inline size_t gs_usb_pack_frame(gs_host_frame* out, uint32_t echo_id, uint32_t can_id, uint8_t dlc,
+                                       const uint8_t* data, uint32_t timestamp_us, bool with_timestamp)
+{
+    if (dlc > 8) dlc = 8;
+    std::memset(out, 0, sizeof(*out));
+    out->echo_id = echo_id;
+    out->can_id = can_id;
+    out->can_dlc = dlc;
+    if (data && !(can_id & GS_CAN_RTR_FLAG)) std::memcpy(out->data, data, dlc);
+    if (!with_timestamp) return GS_HOST_FRAME_SIZE;
+    out->timestamp_us = timestamp_us;
+    return GS_HOST_FRAME_SIZE_TS;
+}
+
+// Mark the first frame delivered after the device dropped frames. The Linux driver
+// counts an rx_over_error and emits a CAN_ERR_CRTL_RX_OVERFLOW error frame.
+static inline void gs_usb_mark_overflow(gs_host_frame* frame)
+{
+    frame->flags |= GS_CAN_FLAG_OVERFLOW;
+}
@@ -4,15 +4,26 @@
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_cpu.h"
 #include "driver/twai.h"
 
 static uint32_t g_can_rx_ok = 0;
 static uint32_t g_can_rx_timeout = 0;
 static uint32_t g_can_rx_other_err = 0;
+// Bridge processing time of forwarded frames (dequeue to last sink write), per stats window
+static uint32_t g_lat_max_cycles = 0;
+static uint64_t g_lat_sum_cycles = 0;
+static uint32_t g_lat_count = 0;
 #include "tinyusb.h"
 #include "tinyusb_cdc_acm.h"
 #include "whitelist.h"
 #include "ble.h"
+#include "gs_usb.h"
+#include "selftest.h"
+#include "vendor_cmd.h"
+#include "bridge_config.h"
+#include "trace.h"
+#include "mem_report.h"
 
 #ifndef APP_NAME
 #define APP_NAME "UnknownApp"
@@ -36,7 +47,6 @@ static const char* TAG = "twai_slcan_cpp";
 #define TWAI_RX_GPIO 17
 #endif
 
-#define TWAI_TIMING TWAI_TIMING_CONFIG_500KBITS()
 #define SLCAN_MAX_FRAME_LEN 32
 
 static inline char nibble_to_hex(uint8_t n)
@@ -47,7 +57,7 @@ static inline char nibble_to_hex(uint8_t n)
 
 #include "led.h"
 
-static int format_slcan_standard(char* out, size_t out_sz, const twai_message_t& msg)
+static BRIDGE_HOT int format_slcan_standard(char* out, size_t out_sz, const twai_message_t& msg)
 {
     if (!out || msg.extd) return -1;
     size_t pos = 0;
@@ -77,12 +87,16 @@ static esp_err_t init_twai()
     twai_general_config_t g_config =
         TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)TWAI_TX_GPIO, (gpio_num_t)TWAI_RX_GPIO, TWAI_MODE_NORMAL);
 
-    // Make RX queue much larger to avoid drops under load.
-    // Tune based on your bus rate + host speed. 256 is a good starting point.
-    g_config.rx_queue_len = 256;
-    g_config.tx_queue_len = 16;
+    // RX queue sized in bridge_config.h from bitrate and BRIDGE_RX_BUFFER_MS.
+    // The driver allocates it from the heap; the boot report shows it under "twai".
+    g_config.rx_queue_len = BRIDGE_TWAI_RX_QUEUE_LEN;
+    g_config.tx_queue_len = BRIDGE_TWAI_TX_QUEUE_LEN;
+#ifdef CONFIG_TWAI_ISR_IN_IRAM
+    // Keep servicing the controller while the flash cache is disabled (NVS/OTA writes)
+    g_config.intr_flags = ESP_INTR_FLAG_LEVEL1 | ESP_INTR_FLAG_IRAM;
+#endif
 
-    twai_timing_config_t t_config = TWAI_TIMING;
+    twai_timing_config_t t_config = BRIDGE_TWAI_TIMING;
     twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
 
     ESP_LOGI(TAG, "Installing TWAI driver...");
@@ -95,35 +109,105 @@ static esp_err_t init_twai()
     return twai_start();
 }
 
-[[noreturn]] static void slcan_task(void* arg)
+// Cycle-counter lap timer: one counter read per stage, results kept in the
+// sample and handed to the instrumentation once per frame
+struct StageTimer
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    uint32_t last = start;
+    StageSample sample = {};
+
+    void lap(BridgeStage stage, bool ok)
+    {
+        uint32_t now = esp_cpu_get_cycle_count();
+        sample.cycles[stage] = now - last;
+        sample.end[stage] = now - start;
+        sample.passed |= 1u << stage;
+        if (ok) sample.ok |= 1u << stage;
+        last = now;
+    }
+
+    uint32_t total() const { return last - start; }
+};
+
+static esp_err_t bridge_receive(twai_message_t* msg, TickType_t ticks_to_wait)
+{
+    // During a self-test, generated frames replace the TWAI queue
+    if (selftest_active()) return selftest_receive(msg, ticks_to_wait);
+    return twai_receive(msg, ticks_to_wait);
+}
+
+static void forward_frame(const twai_message_t& msg, char* buf, size_t buf_sz)
 {
+    StageTimer timer;
+#ifndef IGNORE_WHITELIST
+    uint16_t sid = msg.identifier & 0x7FF;
+    bool pass = is_whitelisted_id(sid);
+#else
+    bool pass = true;
+#endif
+    timer.lap(STAGE_FILTER, pass);
+    if (!pass)
+    {
+        trace_commit(timer.sample);
+        if (selftest_active()) selftest_account(timer.sample);
+        return;
+    }
+
+    if (gs_usb_started())
+    {
+        bool ok = gs_usb_write(msg);
+        timer.lap(STAGE_GS_USB, ok);
+    }
+    int len = format_slcan_standard(buf, buf_sz, msg);
+    timer.lap(STAGE_FORMAT, len > 0);
+    if (len > 0 && tud_cdc_connected())
+    {
+        size_t queued = tinyusb_cdcacm_write_queue(TINYUSB_CDC_ACM_0, reinterpret_cast<const uint8_t*>(buf), len);
+        tinyusb_cdcacm_write_flush(TINYUSB_CDC_ACM_0, 0);
+        timer.lap(STAGE_CDC, queued == (size_t)len);
+    }
+    if (len > 0 && ble_uart_connected())
+    {
+        size_t sent = ble_uart_write(reinterpret_cast<const uint8_t*>(buf), (size_t)len);
+        timer.lap(STAGE_BLE, sent == (size_t)len);
+    }
+
+    trace_commit(timer.sample);
+    if (selftest_active()) selftest_account(timer.sample);
+
+    uint32_t lat = timer.total();
+    if (lat > g_lat_max_cycles) g_lat_max_cycles = lat;
+    g_lat_sum_cycles += lat;
+    g_lat_count++;
+}
+
+static void slcan_task(void* arg)
+{
+    // Installing the driver from this task places the TWAI ISR on the bridge core
+    TaskHandle_t parent = static_cast<TaskHandle_t>(arg);
+    esp_err_t ret = init_twai();
+    xTaskNotify(parent, (uint32_t)ret, eSetValueWithOverwrite);
+    if (ret != ESP_OK)
+    {
+        vTaskDelete(nullptr);
+        return;
+    }
+
     twai_message_t msg;
     char buf[SLCAN_MAX_FRAME_LEN];
     TickType_t last_stat = xTaskGetTickCount();
 
     while (true)
     {
-        esp_err_t r = twai_receive(&msg, pdMS_TO_TICKS(1000));
+        esp_err_t r = bridge_receive(&msg, pdMS_TO_TICKS(1000));
         if (r == ESP_OK)
         {
             g_can_rx_ok++;
 
             if (!msg.extd)
             {
-#ifndef IGNORE_WHITELIST
-                uint16_t sid = msg.identifier & 0x7FF;
-                if (!is_whitelisted_id(sid)) continue;
-#endif
-                int len = format_slcan_standard(buf, sizeof(buf), msg);
-                if (len > 0 && tud_cdc_connected())
-                {
-                    tinyusb_cdcacm_write_queue(TINYUSB_CDC_ACM_0, reinterpret_cast<const uint8_t*>(buf), len);
-                    tinyusb_cdcacm_write_flush(TINYUSB_CDC_ACM_0, 0);
-                }
-                if (len > 0 && ble_uart_connected())
-                {
-                    ble_uart_write(reinterpret_cast<const uint8_t*>(buf), (size_t)len);
-                }
+                forward_frame(msg, buf, sizeof(buf));
             }
         }
         else if (r == ESP_ERR_TIMEOUT)
@@ -142,7 +226,73 @@ static esp_err_t init_twai()
             last_stat = now;
             ESP_LOGI(TAG, "TWAI rx stats: ok=%u timeout=%u other_err=%u",
                      (unsigned)g_can_rx_ok, (unsigned)g_can_rx_timeout, (unsigned)g_can_rx_other_err);
+            unsigned lat_avg = g_lat_count ? (unsigned)(g_lat_sum_cycles / g_lat_count) : 0;
+            ESP_LOGI(TAG, "Bridge processing time (layout=%s core=%d): max=%uus avg=%uus frames=%u",
+                     BRIDGE_LAYOUT_NAME, xPortGetCoreID(),
+                     (unsigned)(g_lat_max_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ),
+                     lat_avg / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, (unsigned)g_lat_count);
+            g_lat_max_cycles = 0;
+            g_lat_sum_cycles = 0;
+            g_lat_count = 0;
+        }
+    }
+}
+
+// Vendor command output on CDC. Reports are larger than the CDC TX FIFO, so wait for
+// the host to drain it instead of dropping the tail; give up if it stops reading.
+// Never called from the TinyUSB task, which has to run for the FIFO to drain.
+static void cdc_write(const char* data, size_t len)
+{
+    TickType_t stalled = 0;
+    while (len > 0 && tud_cdc_connected())
+    {
+        size_t n = tinyusb_cdcacm_write_queue(TINYUSB_CDC_ACM_0, reinterpret_cast<const uint8_t*>(data), len);
+        tinyusb_cdcacm_write_flush(TINYUSB_CDC_ACM_0, 0);
+        data += n;
+        len -= n;
+        if (len == 0) break;
+        if (n > 0)
+            stalled = 0;
+        else if (++stalled > pdMS_TO_TICKS(500))
+            break;
+        vTaskDelay(1);
+    }
+}
+
+// Vendor command output on BLE. Chunks fit the default ATT MTU, so reports get
+// through even when the central has not negotiated a larger one; a chunk that
+// finds the NimBLE mbuf pool exhausted is retried.
+static void ble_cmd_write(const char* data, size_t len)
+{
+    TickType_t stalled = 0;
+    while (len > 0 && ble_uart_connected())
+    {
+        size_t chunk = len < 20 ? len : 20;
+        if (ble_uart_write(reinterpret_cast<const uint8_t*>(data), chunk) == chunk)
+        {
+            data += chunk;
+            len -= chunk;
+            stalled = 0;
+            continue;
         }
+        if (++stalled > pdMS_TO_TICKS(500)) break;
+        vTaskDelay(1);
+    }
+}
+
+static void ble_rx_callback(const uint8_t* data, size_t len)
+{
+    vendor_cmd_feed(VENDOR_CHANNEL_BLE, data, len);
+}
+
+static void cdc_rx_callback(int itf, cdcacm_event_t* event)
+{
+    (void)event;
+    uint8_t rx[64];
+    size_t n = 0;
+    while (tinyusb_cdcacm_read(static_cast<tinyusb_cdcacm_itf_t>(itf), rx, sizeof(rx), &n) == ESP_OK && n > 0)
+    {
+        vendor_cmd_feed(VENDOR_CHANNEL_CDC, rx, n);
     }
 }
 
@@ -150,45 +300,88 @@ static void init_tinyusb()
 {
     tinyusb_config_t tusb_cfg = {};
     tusb_cfg.port = TINYUSB_PORT_FULL_SPEED_0;
-    tusb_cfg.task.size = 4096;
+    tusb_cfg.task.size = BRIDGE_USB_TASK_STACK;
     tusb_cfg.task.priority = 5;
-    tusb_cfg.task.xCoreID = 0;
+    tusb_cfg.task.xCoreID = BRIDGE_USB_CORE;
+    // Optional gs_usb personality (does nothing unless ENABLE_GS_USB is defined)
+    gs_usb_configure(tusb_cfg, BRIDGE_BITRATE);
 
     ESP_LOGI(TAG, "Initializing TinyUSB stack...");
     ESP_ERROR_CHECK(tinyusb_driver_install(&tusb_cfg));
     ESP_LOGI(TAG, "TinyUSB driver installed");
+    // esp_tinyusb creates its task from the heap; track its stack at least
+    mem_report_task(xTaskGetHandle("TinyUSB"), BRIDGE_USB_TASK_STACK);
+
+#ifdef ENABLE_GS_USB
+    // The gs_usb descriptors replace CDC-ACM; Linux binds its native gs_usb driver
+    ESP_LOGI(TAG, "USB personality: gs_usb (candleLight), CDC-ACM disabled");
+    return;
+#endif
 
     tinyusb_config_cdcacm_t cdc_cfg = {};
     cdc_cfg.cdc_port = TINYUSB_CDC_ACM_0;
-    cdc_cfg.callback_rx = nullptr;
+    cdc_cfg.callback_rx = cdc_rx_callback;
     cdc_cfg.callback_rx_wanted_char = nullptr;
     cdc_cfg.callback_line_state_changed = nullptr;
     cdc_cfg.callback_line_coding_changed = nullptr;
+    vendor_cmd_set_output(VENDOR_CHANNEL_CDC, cdc_write);
     ESP_ERROR_CHECK(tinyusb_cdcacm_init(&cdc_cfg));
     ESP_LOGI(TAG, "TinyUSB CDC-ACM initialized");
 }
 
 extern "C" void app_main()
 {
+    mem_report_init();
+
 #ifdef IGNORE_WHITELIST
     ESP_LOGW(TAG, "IGNORE_WHITELIST is defined: forwarding ALL standard CAN frames (no filtering)");
 #endif
 
+    // Vendor commands arrive on CDC and, in BLE builds, on the BLE UART; in gs_usb
+    // builds BLE is the only command channel
+    vendor_cmd_init(BRIDGE_BITRATE);
     init_tinyusb();
+    mem_report_checkpoint("usb");
     // Optional BLE UART (does nothing unless ENABLE_BLE is defined)
+    ble_uart_set_rx_callback(ble_rx_callback);
+    vendor_cmd_set_output(VENDOR_CHANNEL_BLE, ble_cmd_write);
     ble_init();
+    mem_report_checkpoint("ble");
 
 #ifdef RGB_LED_PIN
     ws2812_init();
     ws2812_set_color(0, 255, 0); // Green
+    mem_report_checkpoint("led");
+#endif
+
+#if defined(ENABLE_BLE) && defined(CONFIG_BT_NIMBLE_PINNED_TO_CORE) && BRIDGE_CAN_CORE >= 0
+#if CONFIG_BT_NIMBLE_PINNED_TO_CORE == BRIDGE_CAN_CORE
+    ESP_LOGW(TAG, "NimBLE host is pinned to the CAN core %d; set BT_NIMBLE_PINNED_TO_CORE to %d",
+             BRIDGE_CAN_CORE, BRIDGE_USB_CORE);
+#endif
 #endif
 
-    if (init_twai() != ESP_OK)
+    trace_init();
+    selftest_init();
+
+    ESP_LOGI(TAG, "Core layout %s: CAN core=%d USB core=%d, bridge priority=%d",
+             BRIDGE_LAYOUT_NAME, BRIDGE_CAN_CORE, BRIDGE_USB_CORE, BRIDGE_TASK_PRIORITY);
+    static StaticTask_t s_slcan_tcb;
+    static StackType_t s_slcan_stack[BRIDGE_TASK_STACK];
+    TaskHandle_t task = xTaskCreateStaticPinnedToCore(slcan_task, "slcan_task", BRIDGE_TASK_STACK,
+                                                      xTaskGetCurrentTaskHandle(), BRIDGE_TASK_PRIORITY, s_slcan_stack,
+                                                      &s_slcan_tcb, BRIDGE_CORE_AFFINITY(BRIDGE_CAN_CORE));
+
+    uint32_t ret = ESP_FAIL;
+    xTaskNotifyWait(0, 0, &ret, portMAX_DELAY);
+    if ((esp_err_t)ret != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to init TWAI");
         return;
     }
-
-    xTaskCreate(slcan_task, "slcan_task", 4096, nullptr, 5, nullptr);
+    mem_report_checkpoint("twai");
+    mem_report_static("slcan_task", sizeof(s_slcan_stack) + sizeof(s_slcan_tcb));
+    mem_report_task(task, BRIDGE_TASK_STACK);
+    mem_report_print(nullptr);
     ESP_LOGI(TAG, "SLCAN bridge running");
 }
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#include "mem_report.h"
+
+#include <cstdio>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char* TAG = "mem";
+
+#define MEM_REPORT_MAX_ENTRIES 16
+
+// Linker symbols of the DRAM .data and .bss sections
+extern int _data_start, _data_end, _bss_start, _bss_end;
+
+struct HeapDelta
+{
+    const char* name;
+    int internal;
+    int psram;
+};
+
+struct StaticRegion
+{
+    const char* name;
+    size_t bytes;
+};
+
+struct PoolEntry
+{
+    const char* name;
+    size_t count;
+    size_t block_bytes;
+};
+
+struct TaskEntry
+{
+    TaskHandle_t task;
+    size_t stack_bytes;
+};
+
+static HeapDelta s_deltas[MEM_REPORT_MAX_ENTRIES];
+static size_t s_delta_count = 0;
+static StaticRegion s_statics[MEM_REPORT_MAX_ENTRIES];
+static size_t s_static_count = 0;
+static PoolEntry s_pools[MEM_REPORT_MAX_ENTRIES];
+static size_t s_pool_count = 0;
+static TaskEntry s_tasks[MEM_REPORT_MAX_ENTRIES];
+static size_t s_task_count = 0;
+
+static size_t s_base_internal = 0;
+static size_t s_base_psram = 0;
+static size_t s_last_internal = 0;
+static size_t s_last_psram = 0;
+
+void mem_report_init()
+{
+    s_base_internal = s_last_internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    s_base_psram = s_last_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+void mem_report_checkpoint(const char* component)
+{
+    size_t internal = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    if (s_delta_count < MEM_REPORT_MAX_ENTRIES)
+    {
+        s_deltas[s_delta_count++] = {component, (int)s_last_internal - (int)internal, (int)s_last_psram - (int)psram};
+    }
+    s_last_internal = internal;
+    s_last_psram = psram;
+}
+
+void mem_report_static(const char* name, size_t bytes)
+{
+    if (s_static_count < MEM_REPORT_MAX_ENTRIES) s_statics[s_static_count++] = {name, bytes};
+}
+
+void mem_report_pool(const char* name, size_t count, size_t block_bytes)
+{
+    if (s_pool_count < MEM_REPORT_MAX_ENTRIES) s_pools[s_pool_count++] = {name, count, block_bytes};
+}
+
+void mem_report_task(TaskHandle_t task, size_t stack_bytes)
+{
+    if (task && s_task_count < MEM_REPORT_MAX_ENTRIES) s_tasks[s_task_count++] = {task, stack_bytes};
+}
+
+static void out(vendor_emit_fn emit, const char* body)
+{
+    if (!emit)
+    {
+        ESP_LOGI(TAG, "%s", body);
+        return;
+    }
+    char line[112];
+    std::snprintf(line, sizeof(line), "XM %s\r", body);
+    emit(line);
+}
+
+void mem_report_print(vendor_emit_fn emit)
+{
+    char body[96];
+
+    std::snprintf(body, sizeof(body), "internal total=%u free=%u min_free=%u largest=%u",
+                  (unsigned)heap_caps_get_total_size(MALLOC_CAP_INTERNAL),
+                  (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+                  (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+                  (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+    out(emit, body);
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0)
+    {
+        std::snprintf(body, sizeof(body), "psram total=%u free=%u min_free=%u largest=%u",
+                      (unsigned)heap_caps_get_total_size(MALLOC_CAP_SPIRAM),
+                      (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM),
+                      (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM),
+                      (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM));
+        out(emit, body);
+    }
+    std::snprintf(body, sizeof(body), "dram data=%u bss=%u",
+                  (unsigned)((char*)&_data_end - (char*)&_data_start),
+                  (unsigned)((char*)&_bss_end - (char*)&_bss_start));
+    out(emit, body);
+
+    // Heap taken before app_main (IDF, FreeRTOS) is not broken down; the
+    // components below are measured from the baseline taken in app_main.
+    for (size_t i = 0; i < s_delta_count; i++)
+    {
+        std::snprintf(body, sizeof(body), "heap %s internal=%d psram=%d", s_deltas[i].name, s_deltas[i].internal,
+                      s_deltas[i].psram);
+        out(emit, body);
+    }
+    std::snprintf(body, sizeof(body), "heap total internal=%d psram=%d",
+                  (int)s_base_internal - (int)s_last_internal, (int)s_base_psram - (int)s_last_psram);
+    out(emit, body);
+
+    for (size_t i = 0; i < s_pool_count; i++)
+    {
+        const PoolEntry& p = s_pools[i];
+        std::snprintf(body, sizeof(body), "pool %s count=%u size=%u bytes=%u", p.name, (unsigned)p.count,
+                      (unsigned)p.block_bytes, (unsigned)(p.count * p.block_bytes));
+        out(emit, body);
+    }
+
+    size_t static_total = 0;
+    for (size_t i = 0; i < s_static_count; i++)
+    {
+        std::snprintf(body, sizeof(body), "static %s bytes=%u", s_statics[i].name, (unsigned)s_statics[i].bytes);
+        out(emit, body);
+        static_total += s_statics[i].bytes;
+    }
+    std::snprintf(body, sizeof(body), "static total bytes=%u", (unsigned)static_total);
+    out(emit, body);
+
+    // StackType_t is a byte on ESP-IDF, so the high-water mark is in bytes
+    for (size_t i = 0; i < s_task_count; i++)
+    {
+        const TaskEntry& t = s_tasks[i];
+        unsigned free_min = (unsigned)uxTaskGetStackHighWaterMark(t.task);
+        std::snprintf(body, sizeof(body), "stack %s size=%u used_max=%u free_min=%u", pcTaskGetName(t.task),
+                      (unsigned)t.stack_bytes, (unsigned)t.stack_bytes - free_min, free_min);
+        out(emit, body);
+    }
+}
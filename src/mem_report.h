@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include <cstddef>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "vendor_cmd.h"
+
+// RAM budget report: heap consumed per component (internal RAM and PSRAM),
+// statically allocated regions and task stack high-water marks.
+// Registration is meant for startup (app_main and the init functions it calls);
+// it is not thread safe and silently stops recording when the tables are full.
+
+// Take the heap baseline. Call first thing in app_main.
+void mem_report_init();
+
+// Attribute the heap consumed since the previous checkpoint to a component.
+void mem_report_checkpoint(const char* component);
+
+// Record a statically allocated region (queue storage, task stack and TCB, ...).
+void mem_report_static(const char* name, size_t bytes);
+
+// Record a heap pool allocated by a library from its own configuration (e.g. NimBLE
+// mbufs), so the effective sizes show up in the report.
+void mem_report_pool(const char* name, size_t count, size_t block_bytes);
+
+// Track the stack high-water mark of a task; stack_bytes is its configured size.
+void mem_report_task(TaskHandle_t task, size_t stack_bytes);
+
+// Print the report as "XM ..." lines through emit, or to the log when emit is nullptr.
+void mem_report_print(vendor_emit_fn emit);
@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#include "selftest.h"
+
+#include <cstdio>
+#include <cstring>
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "sdkconfig.h"
+#include "whitelist.h"
+#include "vendor_cmd.h"
+#include "bridge_config.h"
+#include "mem_report.h"
+
+static const char* TAG = "selftest";
+
+#define SELFTEST_MAX_WHITELIST_IDS 64
+// Give the bridge task time to leave a pending twai_receive() before injecting
+#define SELFTEST_SETTLE_MS 1100
+#define SELFTEST_DRAIN_MS 1000
+
+struct StageCounters
+{
+    uint64_t cycles;
+    uint32_t ok;
+    uint32_t fail;
+};
+
+struct SelftestResult
+{
+    SelftestConfig cfg;
+    int64_t elapsed_us;
+    uint32_t generated;
+    uint32_t inject_drops;
+    uint32_t received;
+    StageCounters stage[STAGE_COUNT];
+};
+
+// Injection queue between generator and bridge task. A full queue means the
+// bridge could not keep up and is reported as an injection drop.
+static StaticQueue_t s_queue_buf;
+static uint8_t s_queue_storage[BRIDGE_SELFTEST_QUEUE_LEN * sizeof(twai_message_t)];
+static QueueHandle_t s_queue = nullptr;
+
+// The generator task lives for the whole uptime and sleeps between runs, so its
+// static TCB and stack are never reused while the idle task still owns them.
+static StaticTask_t s_gen_tcb;
+static StackType_t s_gen_stack[BRIDGE_SELFTEST_STACK];
+static TaskHandle_t s_gen_task = nullptr;
+
+volatile bool g_selftest_active = false;
+static volatile bool s_stop = false;
+static SelftestResult s_result = {};
+static bool s_have_result = false;
+
+static uint16_t s_wl_ids[SELFTEST_MAX_WHITELIST_IDS];
+static size_t s_wl_count = 0;
+static uint32_t s_rng = 1;
+
+static uint32_t rng_next()
+{
+    // xorshift32: cheap enough to not distort the generator rate
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static void collect_whitelist_ids()
+{
+    // Derive the list from is_whitelisted_id() so whitelist.cpp stays the only source
+    s_wl_count = 0;
+    for (uint16_t id = 0; id <= 0x7FF && s_wl_count < SELFTEST_MAX_WHITELIST_IDS; id++)
+    {
+        if (is_whitelisted_id(id)) s_wl_ids[s_wl_count++] = id;
+    }
+}
+
+static uint16_t pick_id(uint32_t whitelist_pct)
+{
+    if (s_wl_count > 0 && (rng_next() % 100) < whitelist_pct)
+    {
+        return s_wl_ids[rng_next() % s_wl_count];
+    }
+    uint16_t id;
+    do
+    {
+        id = rng_next() & 0x7FF;
+    }
+    while (is_whitelisted_id(id));
+    return id;
+}
+
+// Nominal length of a standard data frame including IFS, without stuff bits.
+// Ignoring stuffing over-estimates the frame rate, i.e. errs on the heavy side.
+static uint32_t frame_bits(uint8_t dlc)
+{
+    return 47 + 8u * dlc;
+}
+
+static void run()
+{
+    const SelftestConfig cfg = s_result.cfg;
+
+    vTaskDelay(pdMS_TO_TICKS(SELFTEST_SETTLE_MS));
+
+    const int64_t start = esp_timer_get_time();
+    const int64_t end = start + (int64_t)cfg.duration_s * 1000000;
+    uint64_t bits_sent = 0;
+    uint32_t seq = 0;
+    twai_message_t msg = {};
+
+    while (!s_stop)
+    {
+        int64_t now = esp_timer_get_time();
+        if (now >= end) break;
+
+        // Catch up to the target bit budget, then sleep for a tick
+        uint64_t budget = (uint64_t)(now - start) * cfg.bitrate / 1000000 * cfg.load_pct / 100;
+        while (bits_sent < budget)
+        {
+            uint8_t dlc = cfg.dlc == SELFTEST_DLC_RANDOM ? (uint8_t)(rng_next() % 9) : (uint8_t)cfg.dlc;
+            msg.identifier = pick_id(cfg.whitelist_pct);
+            msg.extd = 0;
+            msg.rtr = 0;
+            msg.data_length_code = dlc;
+            // Big-endian sequence number first, so receivers can spot gaps
+            for (uint8_t i = 0; i < dlc; i++)
+            {
+                msg.data[i] = i < 4 ? (uint8_t)(seq >> (8 * (3 - i))) : 0xA5;
+            }
+            seq++;
+            bits_sent += frame_bits(dlc);
+            s_result.generated++;
+            if (xQueueSend(s_queue, &msg, 0) != pdTRUE) s_result.inject_drops++;
+        }
+        vTaskDelay(1);
+    }
+
+    // Let the bridge drain what was injected before measuring
+    const int64_t stop = esp_timer_get_time();
+    int64_t drain_end = stop + SELFTEST_DRAIN_MS * 1000;
+    while (uxQueueMessagesWaiting(s_queue) > 0 && esp_timer_get_time() < drain_end)
+    {
+        vTaskDelay(1);
+    }
+    s_result.elapsed_us = esp_timer_get_time() - start;
+    s_have_result = true;
+
+    ESP_LOGI(TAG, "Run finished: generated=%u inject_drops=%u received=%u in %lld ms",
+             (unsigned)s_result.generated, (unsigned)s_result.inject_drops, (unsigned)s_result.received,
+             (long long)(s_result.elapsed_us / 1000));
+    selftest_report();
+    // Only now may XG start the next run and reset s_result
+    g_selftest_active = false;
+}
+
+static void generator_task(void* arg)
+{
+    (void)arg;
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        run();
+    }
+}
+
+void selftest_init()
+{
+    s_queue = xQueueCreateStatic(BRIDGE_SELFTEST_QUEUE_LEN, sizeof(twai_message_t), s_queue_storage, &s_queue_buf);
+    s_gen_task = xTaskCreateStatic(generator_task, "selftest_gen", BRIDGE_SELFTEST_STACK, nullptr, 4, s_gen_stack,
+                                   &s_gen_tcb);
+    collect_whitelist_ids();
+    mem_report_static("selftest_queue", sizeof(s_queue_storage) + sizeof(s_queue_buf));
+    mem_report_static("selftest_task", sizeof(s_gen_stack) + sizeof(s_gen_tcb));
+    mem_report_task(s_gen_task, sizeof(s_gen_stack));
+}
+
+bool selftest_start(const SelftestConfig& cfg)
+{
+    if (g_selftest_active) return false;
+    if (cfg.load_pct < 1 || cfg.load_pct > 100) return false;
+    if (cfg.duration_s < 1 || cfg.duration_s > 3600) return false;
+    if (cfg.whitelist_pct > 100) return false;
+    if (cfg.dlc != SELFTEST_DLC_RANDOM && (cfg.dlc < 0 || cfg.dlc > 8)) return false;
+    if (cfg.bitrate < 10000 || cfg.bitrate > 1000000) return false;
+
+    if (!s_gen_task) return false;
+    xQueueReset(s_queue);
+
+    s_result = {};
+    s_result.cfg = cfg;
+    s_have_result = false;
+    s_stop = false;
+    s_rng = esp_random() | 1;
+    g_selftest_active = true;
+    xTaskNotifyGive(s_gen_task);
+
+    ESP_LOGW(TAG, "Run started: load=%u%% of %u bit/s for %us, whitelist=%u%%, dlc=%d",
+             (unsigned)cfg.load_pct, (unsigned)cfg.bitrate, (unsigned)cfg.duration_s,
+             (unsigned)cfg.whitelist_pct, cfg.dlc);
+    return true;
+}
+
+void selftest_stop()
+{
+    s_stop = true;
+}
+
+esp_err_t selftest_receive(twai_message_t* msg, TickType_t ticks_to_wait)
+{
+    // Short waits so the bridge returns to the TWAI queue promptly after a run
+    TickType_t wait = ticks_to_wait < pdMS_TO_TICKS(100) ? ticks_to_wait : pdMS_TO_TICKS(100);
+    if (xQueueReceive(s_queue, msg, wait) != pdTRUE) return ESP_ERR_TIMEOUT;
+    s_result.received++;
+    return ESP_OK;
+}
+
+void selftest_account(const StageSample& sample)
+{
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        if (!(sample.passed & (1u << i))) continue;
+        StageCounters& c = s_result.stage[i];
+        c.cycles += sample.cycles[i];
+        if (sample.ok & (1u << i))
+            c.ok++;
+        else
+            c.fail++;
+    }
+}
+
+void selftest_report()
+{
+    char line[128];
+    if (!s_have_result)
+    {
+        vendor_cmd_emit(g_selftest_active ? "XR running\r" : "XR none\r");
+        return;
+    }
+
+    const SelftestResult& r = s_result;
+    const uint64_t elapsed_us = r.elapsed_us > 0 ? (uint64_t)r.elapsed_us : 1;
+    const uint32_t fps = (uint32_t)((uint64_t)r.received * 1000000 / elapsed_us);
+
+    std::snprintf(line, sizeof(line), "XR cfg load=%u bitrate=%u secs=%u wl=%u dlc=%d\r",
+                  (unsigned)r.cfg.load_pct, (unsigned)r.cfg.bitrate, (unsigned)r.cfg.duration_s,
+                  (unsigned)r.cfg.whitelist_pct, r.cfg.dlc);
+    vendor_cmd_emit(line);
+    std::snprintf(line, sizeof(line), "XR total generated=%u inject_drops=%u received=%u elapsed_ms=%u fps=%u\r",
+                  (unsigned)r.generated, (unsigned)r.inject_drops, (unsigned)r.received,
+                  (unsigned)(elapsed_us / 1000), (unsigned)fps);
+    vendor_cmd_emit(line);
+
+    // CPU load in permille of one core at the configured CPU clock
+    const uint64_t core_cycles = elapsed_us * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        const StageCounters& c = r.stage[i];
+        unsigned permille = (unsigned)(c.cycles * 1000 / core_cycles);
+        unsigned avg = (c.ok + c.fail) ? (unsigned)(c.cycles / (c.ok + c.fail)) : 0;
+        std::snprintf(line, sizeof(line), "XR stage=%s ok=%u fail=%u cpu=%u.%u%% avg_cycles=%u\r",
+                      stage_name((BridgeStage)i), (unsigned)c.ok, (unsigned)c.fail,
+                      permille / 10, permille % 10, avg);
+        vendor_cmd_emit(line);
+    }
+}
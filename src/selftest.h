@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "driver/twai.h"
+#include "stage.h"
+
+// Built-in traffic generator for qualifying bridge throughput without a second
+// CAN node. Generated frames are injected in place of twai_receive(), so they
+// run through the real filter, formatter and transports. The bus is not touched:
+// nothing is transmitted, and frames arriving from the bus while a test runs are
+// left in the TWAI queue.
+
+#define SELFTEST_DLC_RANDOM (-1)
+
+struct SelftestConfig
+{
+    uint32_t load_pct; // 1..100 percent of bus capacity at bitrate
+    uint32_t duration_s; // 1..3600
+    uint32_t whitelist_pct; // 0..100 percent of frames using whitelisted IDs
+    int dlc; // 0..8, or SELFTEST_DLC_RANDOM for a uniform 0..8 mix
+    uint32_t bitrate; // bit/s used to pace the generator (need not match the bus)
+};
+
+// Create the (statically allocated) injection queue and the idle generator task.
+void selftest_init();
+
+// Start a run in the background. Returns false if a run is active or cfg is invalid.
+bool selftest_start(const SelftestConfig& cfg);
+
+// Request the active run to stop early; the report is emitted as usual.
+void selftest_stop();
+
+// True while generated frames replace the TWAI receive path. Inline so the
+// bridge task can check it per frame without leaving IRAM.
+extern volatile bool g_selftest_active;
+static inline bool selftest_active()
+{
+    return g_selftest_active;
+}
+
+// Drop-in replacement for twai_receive() while selftest_active().
+esp_err_t selftest_receive(twai_message_t* msg, TickType_t ticks_to_wait);
+
+// Account the stages of one frame. Only call while selftest_active().
+void selftest_account(const StageSample& sample);
+
+// Emit the report of the last finished run on the vendor command channel.
+void selftest_report();
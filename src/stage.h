@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include <cstdint>
+
+// Processing stages of a frame on its way through the bridge (filter, format,
+// and one stage per transport/sink). Shared by the instrumentation modules.
+typedef enum
+{
+    STAGE_FILTER = 0,
+    STAGE_FORMAT,
+    STAGE_CDC,
+    STAGE_BLE,
+    STAGE_GS_USB,
+    STAGE_COUNT
+} BridgeStage;
+
+// Stage timings of one frame, taken with one cycle-counter read per stage
+struct StageSample
+{
+    uint32_t cycles[STAGE_COUNT]; // cycles spent in each stage
+    uint32_t end[STAGE_COUNT]; // cycles from leaving the receive queue to the end of each stage
+    uint8_t passed; // bit per stage the frame went through
+    uint8_t ok; // bit per stage that succeeded (filter: accepted, transports: delivered)
+};
+
+static inline const char* stage_name(BridgeStage stage)
+{
+    switch (stage)
+    {
+        case STAGE_FILTER: return "filter";
+        case STAGE_FORMAT: return "format";
+        case STAGE_CDC: return "cdc";
+        case STAGE_BLE: return "ble";
+        case STAGE_GS_USB: return "gs_usb";
+        default: return "?";
+    }
+}
@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#include "trace.h"
+
+#if !BRIDGE_TRACE
+
+// No-op implementations when tracing is disabled
+void trace_init()
+{
+}
+bool trace_request_dump(bool /*clear*/) { return false; }
+
+#else
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "mem_report.h"
+#include "vendor_cmd.h"
+
+static const char* TAG = "trace";
+
+static_assert((BRIDGE_TRACE_RING_LEN & (BRIDGE_TRACE_RING_LEN - 1)) == 0, "trace ring length must be a power of two");
+
+// Log-linear buckets over nanoseconds: 4 linear sub-buckets per power of two
+// (<= 25% relative error); the last bucket collects everything above ~67 ms.
+// test/trace-histogram.py decodes the same layout.
+#define HIST_SUB_BITS 2
+#define HIST_BUCKETS 100
+
+enum
+{
+    HIST_SINK_GS_USB = STAGE_COUNT,
+    HIST_SINK_CDC,
+    HIST_SINK_BLE,
+    HIST_COUNT
+};
+
+// Index = BridgeStage for per-stage histograms, then per-sink
+static const char* hist_name(int i)
+{
+    switch (i)
+    {
+        case HIST_SINK_GS_USB: return "sink_gs_usb";
+        case HIST_SINK_CDC: return "sink_cdc";
+        case HIST_SINK_BLE: return "sink_ble";
+        default: return stage_name((BridgeStage)i);
+    }
+}
+
+struct Histogram
+{
+    uint32_t count;
+    uint32_t max_ns;
+    uint64_t sum_ns;
+    uint32_t buckets[HIST_BUCKETS];
+};
+
+static StageSample s_ring[BRIDGE_TRACE_RING_LEN];
+static std::atomic<uint32_t> s_head{0}; // written by the bridge task only
+static std::atomic<uint32_t> s_tail{0}; // written by the trace task only
+static uint32_t s_dropped = 0;
+
+static Histogram s_hist[HIST_COUNT];
+static volatile int s_dump_request = 0; // 1 = dump, 2 = dump and clear
+
+static StaticTask_t s_task_tcb;
+static StackType_t s_task_stack[BRIDGE_TRACE_STACK];
+
+void trace_commit(const StageSample& sample)
+{
+    uint32_t head = s_head.load(std::memory_order_relaxed);
+    if (head - s_tail.load(std::memory_order_acquire) >= BRIDGE_TRACE_RING_LEN)
+    {
+        s_dropped++;
+        return;
+    }
+    s_ring[head & (BRIDGE_TRACE_RING_LEN - 1)] = sample;
+    s_head.store(head + 1, std::memory_order_release);
+}
+
+static int bucket_of(uint32_t ns)
+{
+    if (ns < (1u << HIST_SUB_BITS)) return (int)ns;
+    int msb = 31 - __builtin_clz(ns);
+    int idx = ((msb - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + (int)((ns >> (msb - HIST_SUB_BITS)) & ((1u << HIST_SUB_BITS) - 1));
+    return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+}
+
+static void hist_add(Histogram& h, uint32_t cycles)
+{
+    uint64_t ns64 = (uint64_t)cycles * 1000 / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    uint32_t ns = ns64 > UINT32_MAX ? UINT32_MAX : (uint32_t)ns64;
+    h.count++;
+    h.sum_ns += ns;
+    if (ns > h.max_ns) h.max_ns = ns;
+    h.buckets[bucket_of(ns)]++;
+}
+
+static void aggregate(const StageSample& s)
+{
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        if (s.passed & (1u << i)) hist_add(s_hist[i], s.cycles[i]);
+    }
+
+    // Sink: from leaving the TWAI queue to the end of the transport's stage
+    if (s.passed & (1u << STAGE_GS_USB)) hist_add(s_hist[HIST_SINK_GS_USB], s.end[STAGE_GS_USB]);
+    if (s.passed & (1u << STAGE_CDC)) hist_add(s_hist[HIST_SINK_CDC], s.end[STAGE_CDC]);
+    if (s.passed & (1u << STAGE_BLE)) hist_add(s_hist[HIST_SINK_BLE], s.end[STAGE_BLE]);
+}
+
+static void drain()
+{
+    uint32_t tail = s_tail.load(std::memory_order_relaxed);
+    const uint32_t head = s_head.load(std::memory_order_acquire);
+    while (tail != head)
+    {
+        aggregate(s_ring[tail & (BRIDGE_TRACE_RING_LEN - 1)]);
+        tail++;
+    }
+    s_tail.store(tail, std::memory_order_release);
+}
+
+static void dump()
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "XH begin unit=ns sub_bits=%d buckets=%d dropped=%u\r",
+                  HIST_SUB_BITS, HIST_BUCKETS, (unsigned)s_dropped);
+    vendor_cmd_emit(line);
+
+    for (int i = 0; i < HIST_COUNT; i++)
+    {
+        const Histogram& h = s_hist[i];
+        if (h.count == 0) continue;
+        std::snprintf(line, sizeof(line), "XH h %s n=%u sum=%llu max=%u\r", hist_name(i), (unsigned)h.count,
+                      (unsigned long long)h.sum_ns, (unsigned)h.max_ns);
+        vendor_cmd_emit(line);
+
+        // Sparse bucket list, a few pairs per line to keep lines short
+        int len = 0;
+        int pairs = 0;
+        for (int b = 0; b < HIST_BUCKETS; b++)
+        {
+            if (h.buckets[b] == 0) continue;
+            if (pairs == 0) len = std::snprintf(line, sizeof(line), "XH b %s", hist_name(i));
+            len += std::snprintf(line + len, sizeof(line) - len, " %d:%u", b, (unsigned)h.buckets[b]);
+            if (++pairs == 8)
+            {
+                std::snprintf(line + len, sizeof(line) - len, "\r");
+                vendor_cmd_emit(line);
+                pairs = 0;
+            }
+        }
+        if (pairs > 0)
+        {
+            std::snprintf(line + len, sizeof(line) - len, "\r");
+            vendor_cmd_emit(line);
+        }
+    }
+    vendor_cmd_emit("XH end\r");
+}
+
+static void trace_task(void* arg)
+{
+    (void)arg;
+    while (true)
+    {
+        drain();
+        int req = s_dump_request;
+        if (req)
+        {
+            dump();
+            if (req == 2)
+            {
+                std::memset(s_hist, 0, sizeof(s_hist));
+                s_dropped = 0;
+            }
+            s_dump_request = 0;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+void trace_init()
+{
+    TaskHandle_t task = xTaskCreateStaticPinnedToCore(trace_task, "trace", BRIDGE_TRACE_STACK, nullptr, 1, s_task_stack,
+                                                      &s_task_tcb, BRIDGE_CORE_AFFINITY(BRIDGE_USB_CORE));
+    mem_report_static("trace_ring", sizeof(s_ring));
+    mem_report_static("trace_hist", sizeof(s_hist));
+    mem_report_static("trace_task", sizeof(s_task_stack) + sizeof(s_task_tcb));
+    mem_report_task(task, sizeof(s_task_stack));
+    ESP_LOGI(TAG, "Latency tracing enabled: ring=%d records (%u bytes), histograms=%u bytes",
+             BRIDGE_TRACE_RING_LEN, (unsigned)sizeof(s_ring), (unsigned)sizeof(s_hist));
+}
+
+bool trace_request_dump(bool clear)
+{
+    s_dump_request = clear ? 2 : 1;
+    return true;
+}
+
+#endif // BRIDGE_TRACE
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include <cstdint>
+#include "bridge_config.h"
+#include "stage.h"
+
+// Per-frame latency tracing built on the bridge's stage timings (stage.h). Once
+// per frame the bridge task pushes its StageSample into a lock-free
+// single-producer ring that a low-priority task drains into log-linear
+// histograms. Without BRIDGE_TRACE trace_commit() compiles to nothing and the
+// functions below are no-ops.
+
+#if BRIDGE_TRACE
+// Queue the stage timings of one frame. Bridge task only.
+void trace_commit(const StageSample& sample);
+#else
+static inline void trace_commit(const StageSample& /*sample*/)
+{
+}
+#endif
+
+// Start the aggregation task (if BRIDGE_TRACE).
+void trace_init();
+
+// Ask the aggregation task to dump (and optionally clear) the histograms on the
+// vendor command channel.
+// Returns false when tracing is not compiled in.
+bool trace_request_dump(bool clear);
@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#include "vendor_cmd.h"
+
+#include <cstdlib>
+#include <cstring>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "bridge_config.h"
+#include "selftest.h"
+#include "trace.h"
+#include "mem_report.h"
+
+static const char* TAG = "vendor_cmd";
+
+#define VENDOR_CMD_MAX_LINE 64
+#define VENDOR_CMD_QUEUE_LEN 4
+
+// Line assembly state of one channel
+struct LineBuffer
+{
+    char line[VENDOR_CMD_MAX_LINE];
+    size_t len;
+    bool overflow;
+};
+
+struct QueuedLine
+{
+    uint8_t channel;
+    char line[VENDOR_CMD_MAX_LINE];
+};
+
+static vendor_cmd_write_fn s_write[VENDOR_CHANNEL_COUNT] = {};
+static LineBuffer s_rx[VENDOR_CHANNEL_COUNT] = {};
+static volatile uint8_t s_reply_channel = VENDOR_CHANNEL_CDC;
+static uint32_t s_default_bitrate = 500000;
+
+// Complete lines are handed from the receive callbacks to the command task, so
+// replies and reports never block the TinyUSB or NimBLE host task.
+static QueueHandle_t s_queue = nullptr;
+static StaticQueue_t s_queue_buf;
+static uint8_t s_queue_storage[VENDOR_CMD_QUEUE_LEN * sizeof(QueuedLine)];
+
+static SemaphoreHandle_t s_write_lock = nullptr;
+static StaticSemaphore_t s_write_lock_buf;
+
+static StaticTask_t s_task_tcb;
+static StackType_t s_task_stack[BRIDGE_VENDOR_CMD_STACK];
+
+void vendor_cmd_emit(const char* line)
+{
+    vendor_cmd_write_fn write = s_write[s_reply_channel];
+    if (!write) return;
+    // Command task, trace task and selftest end-of-run report share the output;
+    // keep their lines whole
+    xSemaphoreTake(s_write_lock, portMAX_DELAY);
+    write(line, strlen(line));
+    xSemaphoreGive(s_write_lock);
+}
+
+static void reply(bool ok)
+{
+    vendor_cmd_emit(ok ? "\r" : "\a");
+}
+
+// Parse one comma separated field. Empty fields keep the default value.
+static bool next_field(const char*& p, long& value, bool* random = nullptr)
+{
+    if (random && (*p == 'R' || *p == 'r'))
+    {
+        *random = true;
+        p++;
+    }
+    else if (*p != '\0' && *p != ',')
+    {
+        char* end = nullptr;
+        value = std::strtol(p, &end, 10);
+        if (end == p) return false;
+        p = end;
+    }
+    if (*p == ',')
+        p++;
+    else if (*p != '\0')
+        return false;
+    return true;
+}
+
+static bool cmd_selftest_start(const char* p)
+{
+    long load = 100, secs = 10, wl = 100, dlc = 8, kbit = (long)(s_default_bitrate / 1000);
+    bool dlc_random = false;
+    if (!next_field(p, load) || !next_field(p, secs) || !next_field(p, wl) ||
+        !next_field(p, dlc, &dlc_random) || !next_field(p, kbit))
+        return false;
+    if (*p != '\0') return false;
+    if (load < 0 || secs < 0 || wl < 0 || kbit < 0) return false;
+
+    SelftestConfig cfg = {};
+    cfg.load_pct = (uint32_t)load;
+    cfg.duration_s = (uint32_t)secs;
+    cfg.whitelist_pct = (uint32_t)wl;
+    cfg.dlc = dlc_random ? SELFTEST_DLC_RANDOM : (int)dlc;
+    cfg.bitrate = (uint32_t)kbit * 1000;
+    return selftest_start(cfg);
+}
+
+static void dispatch(const char* line)
+{
+    ESP_LOGI(TAG, "Command: %s", line);
+
+    switch (line[1])
+    {
+        case 'G':
+            reply(cmd_selftest_start(line + 2));
+            break;
+        case 'S':
+            selftest_stop();
+            reply(selftest_active());
+            break;
+        case 'R':
+            reply(true);
+            selftest_report();
+            break;
+        case 'H':
+            reply(trace_request_dump(line[2] == 'C'));
+            break;
+        case 'M':
+            reply(true);
+            mem_report_print(vendor_cmd_emit);
+            break;
+        default:
+            reply(false);
+            break;
+    }
+}
+
+static void vendor_cmd_task(void* arg)
+{
+    (void)arg;
+    QueuedLine item;
+    while (true)
+    {
+        if (xQueueReceive(s_queue, &item, portMAX_DELAY) != pdTRUE) continue;
+        s_reply_channel = item.channel;
+        dispatch(item.line);
+    }
+}
+
+void vendor_cmd_init(uint32_t default_bitrate)
+{
+    s_default_bitrate = default_bitrate;
+    s_write_lock = xSemaphoreCreateMutexStatic(&s_write_lock_buf);
+    s_queue = xQueueCreateStatic(VENDOR_CMD_QUEUE_LEN, sizeof(QueuedLine), s_queue_storage, &s_queue_buf);
+    TaskHandle_t task = xTaskCreateStaticPinnedToCore(vendor_cmd_task, "vendor_cmd", BRIDGE_VENDOR_CMD_STACK, nullptr,
+                                                      2, s_task_stack, &s_task_tcb,
+                                                      BRIDGE_CORE_AFFINITY(BRIDGE_USB_CORE));
+    mem_report_static("vendor_cmd_queue", sizeof(s_queue_storage) + sizeof(s_queue_buf));
+    mem_report_static("vendor_cmd_task", sizeof(s_task_stack) + sizeof(s_task_tcb));
+    mem_report_task(task, sizeof(s_task_stack));
+}
+
+void vendor_cmd_set_output(VendorChannel channel, vendor_cmd_write_fn write)
+{
+    s_write[channel] = write;
+}
+
+void vendor_cmd_feed(VendorChannel channel, const uint8_t* data, size_t len)
+{
+    LineBuffer& rx = s_rx[channel];
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = (char)data[i];
+        if (c == '\r' || c == '\n')
+        {
+            // Lines not starting with 'X' are not ours; the bridge does not implement host->bus SLCAN
+            if (rx.len > 0 && !rx.overflow && rx.line[0] == 'X')
+            {
+                QueuedLine item;
+                item.channel = (uint8_t)channel;
+                std::memcpy(item.line, rx.line, rx.len);
+                item.line[rx.len] = '\0';
+                if (!s_queue || xQueueSend(s_queue, &item, 0) != pdTRUE)
+                    ESP_LOGW(TAG, "Command dropped, queue full: %s", item.line);
+            }
+            rx.len = 0;
+            rx.overflow = false;
+        }
+        else if (rx.len < VENDOR_CMD_MAX_LINE - 1)
+        {
+            rx.line[rx.len++] = c;
+        }
+        else
+        {
+            rx.overflow = true;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Vendor extension commands on the SLCAN command channels: USB CDC-ACM RX and,
+// in BLE builds, the BLE UART RX characteristic (the only one in gs_usb builds).
+// Commands are lines starting with 'X' and terminated by '\r' or '\n'.
+// As in SLCAN, an accepted command is answered with '\r' and a rejected one with
+// '\a' (BEL); report lines start with "X" so SLCAN parsers skip them.
+// Replies go to the channel the command came from; reports that follow later
+// (end of a self-test run, histogram dump) go to the channel of the last command.
+//
+//   XG[load],[secs],[wl],[dlc|R],[kbit]   start self-test traffic generator
+//   XS                                    stop generator (report follows)
+//   XR                                    print last self-test report
+//   XH[C]                                 dump latency histograms (C: then clear)
+//   XM                                    print RAM budget and stack high-water marks
+
+enum VendorChannel
+{
+    VENDOR_CHANNEL_CDC,
+    VENDOR_CHANNEL_BLE,
+    VENDOR_CHANNEL_COUNT
+};
+
+// Output of a channel, used for replies and reports.
+typedef void (*vendor_cmd_write_fn)(const char* data, size_t len);
+
+// Start the command task. Call before any channel is registered.
+void vendor_cmd_init(uint32_t default_bitrate);
+
+// Register a channel's output. write is called from the command, trace and
+// selftest tasks (never from the caller of vendor_cmd_feed) and may block until
+// the host has taken the data.
+void vendor_cmd_set_output(VendorChannel channel, vendor_cmd_write_fn write);
+
+// Report line sink: one complete line ending in '\r'.
+typedef void (*vendor_emit_fn)(const char* line);
+
+// Sink of the channel of the last command, used by the selftest, trace and XM
+// reports. Lines are dropped while that channel has no output.
+void vendor_cmd_emit(const char* line);
+
+// Feed bytes received on a channel; complete lines are queued for the command task.
+void vendor_cmd_feed(VendorChannel channel, const uint8_t* data, size_t len);
@@ -1,8 +1,9 @@
 // SPDX-License-Identifier: GPL-3.0-only
 #include "whitelist.h"
+#include "bridge_config.h"
 
 // Always compile the actual whitelist here; optional bypass is handled in main.cpp
-bool is_whitelisted_id(uint16_t id)
+static constexpr bool is_listed(uint16_t id)
 {
     switch (id)
     {
@@ -39,3 +40,28 @@ bool is_whitelisted_id(uint16_t id)
             return false;
     }
 }
+
+// The switch above is expanded at compile time into a 2048-bit table in DRAM, so the
+// per-frame lookup neither branches through a jump table nor touches flash.
+struct WhitelistBitmap
+{
+    uint32_t words[0x800 / 32];
+};
+
+static constexpr WhitelistBitmap make_bitmap()
+{
+    WhitelistBitmap b = {};
+    for (uint16_t id = 0; id < 0x800; id++)
+    {
+        if (is_listed(id)) b.words[id >> 5] |= 1u << (id & 31);
+    }
+    return b;
+}
+
+static DRAM_ATTR const WhitelistBitmap s_bitmap = make_bitmap();
+
+BRIDGE_HOT bool is_whitelisted_id(uint16_t id)
+{
+    if (id >= 0x800) return false;
+    return (s_bitmap.words[id >> 5] >> (id & 31)) & 1u;
+}
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+"""
+Fetch the latency histograms of a bridge built with CONFIG_BRIDGE_TRACE (vendor
+command XH over USB CDC-ACM) and print percentiles per stage and per sink.
+
+  ./trace-histogram.py               # first /dev/ttyACM*, dump only
+  ./trace-histogram.py --clear       # dump, then reset the histograms on the device
+  ./trace-histogram.py --file x.txt  # decode a saved dump (lines starting with "XH")
+"""
+import argparse
+import glob
+import sys
+import time
+
+BAUDRATE = 576000
+PERCENTILES = (50, 90, 99, 99.9)
+
+
+def detect_acm_device() -> str | None:
+    devices = sorted(glob.glob("/dev/ttyACM*"))
+    return devices[0] if devices else None
+
+
+def read_dump_serial(dev: str, clear: bool, timeout_s: float = 3.0) -> list[str]:
+    import serial
+
+    ser = serial.Serial(dev, BAUDRATE, timeout=0.2, rtscts=False, dsrdtr=False)
+    try:
+        ser.reset_input_buffer()
+        ser.write(b"XHC\r" if clear else b"XH\r")
+        lines, buffer = [], b""
+        end = time.time() + timeout_s
+        while time.time() < end:
+            buffer += ser.read(4096)
+            while b"\r" in buffer:
+                line, _, buffer = buffer.partition(b"\r")
+                text = line.decode(errors="ignore").lstrip("\a")
+                if not text.startswith("XH"):
+                    continue  # SLCAN frames keep flowing during the dump
+                lines.append(text)
+                if text.startswith("XH end"):
+                    return lines
+        raise TimeoutError("no complete XH dump received (tracing not compiled in?)")
+    finally:
+        ser.close()
+
+
+def bucket_bounds(idx: int, sub_bits: int) -> tuple[int, int]:
+    """Inverse of bucket_of() in src/trace.cpp: [low, high) in ns."""
+    sub = 1 << sub_bits
+    if idx < sub:
+        return idx, idx + 1
+    msb = (idx >> sub_bits) + sub_bits - 1
+    width = 1 << (msb - sub_bits)
+    low = (1 << msb) + (idx & (sub - 1)) * width
+    return low, low + width
+
+
+def parse_dump(lines: list[str]):
+    meta, hists = {}, {}
+    for line in lines:
+        parts = line.split()
+        if len(parts) < 2:
+            continue
+        kind = parts[1]
+        if kind == "begin":
+            meta = dict(p.split("=", 1) for p in parts[2:])
+        elif kind == "h":
+            fields = dict(p.split("=", 1) for p in parts[3:])
+            hists[parts[2]] = {
+                "n": int(fields["n"]),
+                "sum": int(fields["sum"]),
+                "max": int(fields["max"]),
+                "buckets": {},
+            }
+        elif kind == "b":
+            h = hists[parts[2]]
+            for pair in parts[3:]:
+                idx, count = pair.split(":")
+                h["buckets"][int(idx)] = int(count)
+    return meta, hists
+
+
+def percentile(h, sub_bits: int, q: float) -> float:
+    target = h["n"] * q / 100.0
+    seen = 0
+    for idx in sorted(h["buckets"]):
+        count = h["buckets"][idx]
+        if seen + count >= target:
+            low, high = bucket_bounds(idx, sub_bits)
+            # linear interpolation inside the bucket, capped by the observed max
+            frac = (target - seen) / count if count else 0.0
+            return min(low + frac * (high - low), h["max"])
+        seen += count
+    return h["max"]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--device", help="CDC-ACM device (default: first /dev/ttyACM*)")
+    ap.add_argument("--file", help="decode a saved dump instead of querying the device")
+    ap.add_argument("--clear", action="store_true", help="reset the histograms after the dump")
+    args = ap.parse_args()
+
+    if args.file:
+        with open(args.file) as f:
+            lines = [l.strip().lstrip("\a") for l in f.read().replace("\r", "\n").splitlines()]
+        lines = [l for l in lines if l.startswith("XH")]
+    else:
+        dev = args.device or detect_acm_device()
+        if not dev:
+            print("❌ No /dev/ttyACM* device found")
+            sys.exit(1)
+        lines = read_dump_serial(dev, args.clear)
+
+    meta, hists = parse_dump(lines)
+    sub_bits = int(meta.get("sub_bits", 2))
+    print(f"dropped trace records: {meta.get('dropped', '?')}")
+    header = f"{'histogram':<12} {'count':>9} {'mean':>9}" + "".join(f" {'p' + str(q):>9}" for q in PERCENTILES)
+    print(header + f" {'max':>9}   (µs)")
+    for name, h in hists.items():
+        if h["n"] == 0:
+            continue
+        cols = [h["sum"] / h["n"]] + [percentile(h, sub_bits, q) for q in PERCENTILES] + [h["max"]]
+        print(f"{name:<12} {h['n']:>9}" + "".join(f" {c / 1000:>9.2f}" for c in cols))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-3.0-only
+//
+// Checks gs_usb_can_id() and gs_usb_pack_frame() byte for byte against the
+// layout the Linux gs_usb driver expects (little-endian host assumed, as on the
+// device).
+
+#include <cstdio>
+#include <cstring>
+
+#include "gs_usb_frame.h"
+
+static int s_failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);                              \
+            s_failures++;                                                                                              \
+        }                                                                                                              \
+    }                                                                                                                  \
+    while (0)
+
+static void check_bytes(const gs_host_frame& f, size_t len, const uint8_t* expected, size_t expected_len,
+                        const char* name)
+{
+    if (len != expected_len)
+    {
+        std::fprintf(stderr, "%s: length %zu, expected %zu\n", name, len, expected_len);
+        s_failures++;
+        return;
+    }
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&f);
+    for (size_t i = 0; i < len; i++)
+    {
+        if (p[i] != expected[i])
+        {
+            std::fprintf(stderr, "%s: byte %zu is %02X, expected %02X\n", name, i, p[i], expected[i]);
+            s_failures++;
+        }
+    }
+}
+
+static const uint8_t kData[8] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+
+static void test_can_id()
+{
+    CHECK(gs_usb_can_id(0x123, false, false) == 0x00000123u);
+    CHECK(gs_usb_can_id(0x923, false, false) == 0x00000123u); // masked to 11 bits
+    CHECK(gs_usb_can_id(0x1ABCDEF0, true, false) == 0x9ABCDEF0u);
+    CHECK(gs_usb_can_id(0x123, false, true) == 0x40000123u);
+    CHECK(gs_usb_can_id(0x1ABCDEF0, true, true) == 0xDABCDEF0u);
+}
+
+static void test_standard()
+{
+    gs_host_frame f;
+    size_t len = gs_usb_pack_frame(&f, GS_HOST_FRAME_ECHO_ID_RX, gs_usb_can_id(0x123, false, false), 3, kData, 0,
+                                   false);
+    const uint8_t expected[] = {
+        0xFF, 0xFF, 0xFF, 0xFF, // echo_id
+        0x23, 0x01, 0x00, 0x00, // can_id
+        0x03, 0x00, 0x00, 0x00, // dlc, channel, flags, reserved
+        0x11, 0x22, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    check_bytes(f, len, expected, sizeof(expected), "standard");
+}
+
+static void test_extended_timestamp()
+{
+    gs_host_frame f;
+    size_t len = gs_usb_pack_frame(&f, 7, gs_usb_can_id(0x1ABCDEF0, true, false), 8, kData, 0x01020304, true);
+    const uint8_t expected[] = {
+        0x07, 0x00, 0x00, 0x00,
+        0xF0, 0xDE, 0xBC, 0x9A,
+        0x08, 0x00, 0x00, 0x00,
+        0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+        0x04, 0x03, 0x02, 0x01, // timestamp_us
+    };
+    check_bytes(f, len, expected, sizeof(expected), "extended+timestamp");
+}
+
+static void test_rtr()
+{
+    // RTR frames carry a DLC but no data
+    gs_host_frame f;
+    size_t len = gs_usb_pack_frame(&f, GS_HOST_FRAME_ECHO_ID_RX, gs_usb_can_id(0x7FF, false, true), 4, kData, 0,
+                                   false);
+    const uint8_t expected[] = {
+        0xFF, 0xFF, 0xFF, 0xFF,
+        0xFF, 0x07, 0x00, 0x40,
+        0x04, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    check_bytes(f, len, expected, sizeof(expected), "rtr");
+}
+
+static void test_dlc_clamp()
+{
+    gs_host_frame f;
+    size_t len = gs_usb_pack_frame(&f, 1, gs_usb_can_id(0x100, false, false), 15, kData, 0xAABBCCDD, true);
+    const uint8_t expected[] = {
+        0x01, 0x00, 0x00, 0x00,
+        0x00, 0x01, 0x00, 0x00,
+        0x08, 0x00, 0x00, 0x00,
+        0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88,
+        0xDD, 0xCC, 0xBB, 0xAA,
+    };
+    check_bytes(f, len, expected, sizeof(expected), "dlc clamp");
+}
+
+static void test_no_data()
+{
+    // A null data pointer leaves the payload zeroed
+    gs_host_frame f;
+    std::memset(&f, 0xEE, sizeof(f));
+    size_t len = gs_usb_pack_frame(&f, 2, gs_usb_can_id(0x10, false, false), 2, nullptr, 0, false);
+    CHECK(len == GS_HOST_FRAME_SIZE);
+    CHECK(f.can_dlc == 2);
+    CHECK(f.data[0] == 0 && f.data[1] == 0);
+    CHECK(f.timestamp_us == 0);
+}
+
+static void test_overflow()
+{
+    // The first frame after a drop carries GS_CAN_FLAG_OVERFLOW; nothing else changes
+    gs_host_frame f;
+    size_t len = gs_usb_pack_frame(&f, GS_HOST_FRAME_ECHO_ID_RX, gs_usb_can_id(0x123, false, false), 3, kData, 0,
+                                   false);
+    gs_usb_mark_overflow(&f);
+    const uint8_t expected[] = {
+        0xFF, 0xFF, 0xFF, 0xFF,
+        0x23, 0x01, 0x00, 0x00,
+        0x03, 0x00, 0x01, 0x00, // flags = GS_CAN_FLAG_OVERFLOW
+        0x11, 0x22, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00,
+    };
+    check_bytes(f, len, expected, sizeof(expected), "overflow");
+}
+
+int main()
+{
+    test_can_id();
+    test_standard();
+    test_extended_timestamp();
+    test_rtr();
+    test_dlc_clamp();
+    test_no_data();
+    test_overflow();
+    if (s_failures)
+    {
+        std::fprintf(stderr, "%d check(s) failed\n", s_failures);
+        return 1;
+    }
+    std::printf("gs_usb_frame: all checks passed\n");
+    return 0;
+}
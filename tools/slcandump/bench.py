@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""
+Benchmark slcandump against the Python parsing loops in test/.
+
+Generates a large synthetic SLCAN capture (or uses one given with --capture), then
+converts it with:
+  - slcandump (candump, asc and bin output)
+  - the ACM-candump.py loop: 256-byte reads, parse_slcan_line(), write + flush per line
+  - the BLE-candump.py loop: same parser, but the log file is reopened per line
+
+Usage:
+  cmake -S tools/slcandump -B build-host && cmake --build build-host
+  python3 tools/slcandump/bench.py --tool build-host/slcandump --lines 1000000
+"""
+import argparse
+import importlib.util
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import time
+import types
+
+REPO = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+
+def load_acm_parser():
+    # ACM-candump.py imports pyserial at module level; the parser itself does not need it
+    if "serial" not in sys.modules:
+        try:
+            import serial  # noqa: F401
+        except ImportError:
+            sys.modules["serial"] = types.ModuleType("serial")
+    path = os.path.join(REPO, "test", "ACM-candump.py")
+    spec = importlib.util.spec_from_file_location("acm_candump", path)
+    mod = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(mod)
+    return mod.parse_slcan_line
+
+
+def generate_capture(path: str, lines: int):
+    rnd = random.Random(1)
+    with open(path, "w", newline="") as f:
+        chunk = []
+        for i in range(lines):
+            dlc = rnd.randint(0, 8)
+            data = "".join(f"{rnd.randint(0, 255):02X}" for _ in range(dlc))
+            kind = rnd.random()
+            if kind < 0.90:
+                line = f"t{rnd.randint(0, 0x7FF):03X}{dlc}{data}"
+            elif kind < 0.98:
+                line = f"T{rnd.randint(0, 0x1FFFFFFF):08X}{dlc}{data}"
+            else:
+                line = f"r{rnd.randint(0, 0x7FF):03X}{dlc}"
+            chunk.append(line + "\r")
+            if len(chunk) == 10000:
+                f.write("".join(chunk))
+                chunk = []
+        f.write("".join(chunk))
+
+
+def python_acm_loop(parse, capture: str, out: str) -> int:
+    frames = 0
+    with open(capture, "rb") as src, open(out, "w") as logfile:
+        buffer = b""
+        while True:
+            data = src.read(256)
+            if not data:
+                break
+            buffer += data
+            while b"\r" in buffer:
+                line, _, buffer = buffer.partition(b"\r")
+                candump = parse(line.decode(errors="ignore"))
+                if candump:
+                    logfile.write(candump + "\n")
+                    logfile.flush()
+                    frames += 1
+    return frames
+
+
+def python_ble_loop(parse, capture: str, out: str) -> int:
+    frames = 0
+    rx_buffer = bytearray()
+    with open(capture, "rb") as src:
+        while True:
+            data = src.read(20)  # one BLE notification payload
+            if not data:
+                break
+            rx_buffer.extend(data)
+            while b"\r" in rx_buffer:
+                line, _, rest = rx_buffer.partition(b"\r")
+                rx_buffer = bytearray(rest)
+                candump = parse(line.decode(errors="ignore"))
+                if candump:
+                    with open(out, "a") as f:
+                        f.write(candump + "\n")
+                    frames += 1
+    return frames
+
+
+def timed(label: str, frames_expected: int, fn):
+    t0 = time.perf_counter()
+    frames = fn()
+    dt = time.perf_counter() - t0
+    if frames is None:
+        frames = frames_expected
+    print(f"{label:<28} {dt:8.3f} s  {frames / dt:12.0f} frames/s")
+    return dt
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--tool", default=os.path.join(REPO, "build-host", "slcandump"))
+    ap.add_argument("--capture", help="existing SLCAN capture (CR terminated lines)")
+    ap.add_argument("--lines", type=int, default=1000000)
+    ap.add_argument("--skip-ble", action="store_true", help="skip the (very slow) reopen-per-line loop")
+    args = ap.parse_args()
+
+    parse = load_acm_parser()
+    with tempfile.TemporaryDirectory() as tmp:
+        capture = args.capture
+        if not capture:
+            capture = os.path.join(tmp, "capture.slcan")
+            generate_capture(capture, args.lines)
+        lines = sum(1 for _ in open(capture, "rb").read().split(b"\r") if _)
+        size_mb = os.path.getsize(capture) / 1e6
+        print(f"capture: {lines} lines, {size_mb:.1f} MB")
+
+        def run_tool(fmt):
+            def go():
+                subprocess.run([args.tool, "-i", capture, "-o", os.path.join(tmp, "out." + fmt), "-f", fmt,
+                                "-t", "host", "-g", "0"], check=True, stderr=subprocess.DEVNULL)
+            return go
+
+        t_tool = timed("slcandump -f candump", lines, run_tool("candump"))
+        timed("slcandump -f asc", lines, run_tool("asc"))
+        timed("slcandump -f bin", lines, run_tool("bin"))
+        t_acm = timed("python ACM-candump loop", lines,
+                      lambda: python_acm_loop(parse, capture, os.path.join(tmp, "acm.log")))
+        print(f"speedup vs ACM loop: {t_acm / t_tool:.0f}x")
+        if not args.skip_ble:
+            t_ble = timed("python BLE-candump loop", lines,
+                          lambda: python_ble_loop(parse, capture, os.path.join(tmp, "ble.log")))
+            print(f"speedup vs BLE loop: {t_ble / t_tool:.0f}x")
+
+
+if __name__ == "__main__":
+    main()
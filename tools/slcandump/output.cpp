@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#include "output.h"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+static const char kHexDigits[] = "0123456789ABCDEF";
+
+// Linux struct can_frame can_id flags, reused by the binary format
+static constexpr uint32_t CAN_EFF_FLAG = 0x80000000u;
+static constexpr uint32_t CAN_RTR_FLAG = 0x40000000u;
+
+OutputWriter::OutputWriter(int fd, OutputFormat format, const char* iface)
+    : fd_(fd), format_(format), iface_(iface), buf_(new char[kCapacity])
+{
+}
+
+OutputWriter::~OutputWriter()
+{
+    flush();
+    delete[] buf_;
+}
+
+bool OutputWriter::flush()
+{
+    size_t off = 0;
+    while (off < len_)
+    {
+        ssize_t n = ::write(fd_, buf_ + off, len_ - off);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            len_ = 0;
+            return false;
+        }
+        off += (size_t)n;
+    }
+    written_ += len_;
+    len_ = 0;
+    return true;
+}
+
+void OutputWriter::put(const char* s, size_t n)
+{
+    reserve(n);
+    std::memcpy(buf_ + len_, s, n);
+    len_ += n;
+}
+
+void OutputWriter::put_str(const char* s)
+{
+    put(s, std::strlen(s));
+}
+
+void OutputWriter::put_hex(uint32_t v, int digits)
+{
+    reserve((size_t)digits);
+    for (int i = digits - 1; i >= 0; i--)
+    {
+        buf_[len_ + i] = kHexDigits[v & 0xF];
+        v >>= 4;
+    }
+    len_ += (size_t)digits;
+}
+
+void OutputWriter::put_dec(uint64_t v, int min_digits)
+{
+    char tmp[24];
+    int n = 0;
+    do
+    {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    }
+    while (v != 0 || n < min_digits);
+    reserve((size_t)n);
+    while (n > 0) buf_[len_++] = tmp[--n];
+}
+
+void OutputWriter::begin(uint64_t start_us)
+{
+    start_us_ = start_us;
+    if (format_ == FORMAT_ASC)
+    {
+        char date[64];
+        time_t t = (time_t)(start_us / 1000000);
+        struct tm tm_local;
+        localtime_r(&t, &tm_local);
+        std::strftime(date, sizeof(date), "%a %b %d %I:%M:%S.000 %p %Y", &tm_local);
+        put_str("date ");
+        put_str(date);
+        put_str("\nbase hex  timestamps absolute\nno internal events logged\n// version 9.0.0\n");
+        put_str("Begin Triggerblock ");
+        put_str(date);
+        put_str("\n");
+    }
+    else if (format_ == FORMAT_BINARY)
+    {
+        // magic "SLCB", version 1, 3 reserved bytes
+        static const char header[8] = {'S', 'L', 'C', 'B', 1, 0, 0, 0};
+        put(header, sizeof(header));
+    }
+}
+
+void OutputWriter::end()
+{
+    if (format_ == FORMAT_ASC) put_str("End TriggerBlock\n");
+    flush();
+}
+
+void OutputWriter::frame(const SlcanFrame& f, uint64_t timestamp_us)
+{
+    switch (format_)
+    {
+        case FORMAT_CANDUMP: frame_candump(f, timestamp_us); break;
+        case FORMAT_ASC: frame_asc(f, timestamp_us); break;
+        case FORMAT_BINARY: frame_binary(f, timestamp_us); break;
+    }
+}
+
+// (1436509052.249713) can0 123#DEADBEEF
+void OutputWriter::frame_candump(const SlcanFrame& f, uint64_t timestamp_us)
+{
+    put("(", 1);
+    put_dec(timestamp_us / 1000000, 10);
+    put(".", 1);
+    put_dec(timestamp_us % 1000000, 6);
+    put(") ", 2);
+    put_str(iface_);
+    put(" ", 1);
+    put_hex(f.id, f.extended ? 8 : 3);
+    put("#", 1);
+    if (f.rtr)
+    {
+        put("R", 1);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < f.dlc; i++) put_hex(f.data[i], 2);
+    }
+    put("\n", 1);
+}
+
+//    1.234567 1  123             Rx   d 8 01 02 03 04 05 06 07 08
+void OutputWriter::frame_asc(const SlcanFrame& f, uint64_t timestamp_us)
+{
+    uint64_t rel = timestamp_us >= start_us_ ? timestamp_us - start_us_ : 0;
+    char sec[24];
+    int n = 0;
+    uint64_t s = rel / 1000000;
+    do
+    {
+        sec[n++] = (char)('0' + s % 10);
+        s /= 10;
+    }
+    while (s != 0);
+    for (int pad = n; pad < 4; pad++) put(" ", 1);
+    while (n > 0) put(&sec[--n], 1);
+    put(".", 1);
+    put_dec(rel % 1000000, 6);
+    put(" 1  ", 4);
+
+    int id_len;
+    if (f.extended)
+    {
+        // ASC writes IDs without leading zeros
+        int digits = 1;
+        while (digits < 8 && (f.id >> (4 * digits)) != 0) digits++;
+        put_hex(f.id, digits);
+        put("x", 1);
+        id_len = digits + 1;
+    }
+    else
+    {
+        int digits = f.id > 0xFF ? 3 : (f.id > 0xF ? 2 : 1);
+        put_hex(f.id, digits);
+        id_len = digits;
+    }
+    for (int pad = id_len; pad < 16; pad++) put(" ", 1);
+
+    if (f.rtr)
+    {
+        put("Rx   r ", 7);
+        put_hex(f.dlc, 1);
+    }
+    else
+    {
+        put("Rx   d ", 7);
+        put_hex(f.dlc, 1);
+        for (uint8_t i = 0; i < f.dlc; i++)
+        {
+            put(" ", 1);
+            put_hex(f.data[i], 2);
+        }
+    }
+    put("\n", 1);
+}
+
+// u64 timestamp_us | u32 can_id (EFF/RTR flags) | u8 dlc | dlc data bytes (none for RTR)
+void OutputWriter::frame_binary(const SlcanFrame& f, uint64_t timestamp_us)
+{
+    uint8_t rec[13 + 8];
+    for (int i = 0; i < 8; i++) rec[i] = (uint8_t)(timestamp_us >> (8 * i));
+    uint32_t can_id = f.id | (f.extended ? CAN_EFF_FLAG : 0) | (f.rtr ? CAN_RTR_FLAG : 0);
+    for (int i = 0; i < 4; i++) rec[8 + i] = (uint8_t)(can_id >> (8 * i));
+    rec[12] = f.dlc;
+    size_t n = 13;
+    if (!f.rtr)
+    {
+        std::memcpy(rec + 13, f.data, f.dlc);
+        n += f.dlc;
+    }
+    put(reinterpret_cast<const char*>(rec), n);
+}
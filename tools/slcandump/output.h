@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "slcan_parser.h"
+
+enum OutputFormat
+{
+    FORMAT_CANDUMP, // candump -l log format, replayable with canplayer
+    FORMAT_ASC, // Vector ASC
+    FORMAT_BINARY, // compact binary records, see README
+};
+
+// Buffered frame writer. Formats directly into a large buffer and issues one
+// write() per buffer, independent of the frame rate.
+class OutputWriter
+{
+public:
+    OutputWriter(int fd, OutputFormat format, const char* iface);
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    // Write the file header (ASC, binary); start_us is the wall-clock start time.
+    void begin(uint64_t start_us);
+    // Write the file trailer (ASC) and flush.
+    void end();
+
+    void frame(const SlcanFrame& f, uint64_t timestamp_us);
+
+    // Returns false if the output is gone (e.g. closed pipe).
+    bool flush();
+
+    uint64_t bytes_written() const { return written_; }
+
+private:
+    void reserve(size_t n)
+    {
+        if (len_ + n > kCapacity) flush();
+    }
+    void put(const char* s, size_t n);
+    void put_str(const char* s);
+    void put_hex(uint32_t v, int digits);
+    void put_dec(uint64_t v, int min_digits);
+
+    void frame_candump(const SlcanFrame& f, uint64_t timestamp_us);
+    void frame_asc(const SlcanFrame& f, uint64_t timestamp_us);
+    void frame_binary(const SlcanFrame& f, uint64_t timestamp_us);
+
+    static constexpr size_t kCapacity = 256 * 1024;
+
+    int fd_;
+    OutputFormat format_;
+    const char* iface_;
+    char* buf_;
+    size_t len_ = 0;
+    uint64_t written_ = 0;
+    uint64_t start_us_ = 0;
+};
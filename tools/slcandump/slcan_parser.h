@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-3.0-only
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Zero-copy SLCAN line parser. Lines are parsed in place from the read buffer;
+ * nothing is copied or allocated.
+ *
+ * Supported lines (terminator already stripped):
+ *   tiiiL<data>[ssss]        standard data frame
+ *   Tiiiiiiiil<data>[ssss]   extended data frame
+ *   riiiL[ssss]              standard remote frame
+ *   RiiiiiiiiL[ssss]         extended remote frame
+ * ssss is the optional SLCAN timestamp (hex milliseconds, 0..0xEA5F).
+ * Vendor lines ('X...') and empty lines are ignored.
+ **/
+
+struct SlcanFrame
+{
+    uint32_t id;
+    bool extended;
+    bool rtr;
+    uint8_t dlc;
+    uint8_t data[8];
+    int32_t timestamp_ms; // -1 when the line carries no timestamp
+};
+
+enum SlcanResult
+{
+    SLCAN_FRAME,
+    SLCAN_IGNORED,
+    SLCAN_MALFORMED,
+};
+
+// 0xFF marks a non-hex character
+struct SlcanHexTable
+{
+    uint8_t v[256];
+
+    constexpr SlcanHexTable() : v()
+    {
+        for (int i = 0; i < 256; i++) v[i] = 0xFF;
+        for (int i = 0; i < 10; i++) v['0' + i] = (uint8_t)i;
+        for (int i = 0; i < 6; i++)
+        {
+            v['A' + i] = (uint8_t)(10 + i);
+            v['a' + i] = (uint8_t)(10 + i);
+        }
+    }
+};
+
+static constexpr SlcanHexTable kSlcanHex;
+
+static inline bool slcan_hex(const char* p, size_t n, uint32_t& out)
+{
+    uint32_t v = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        uint8_t h = kSlcanHex.v[(uint8_t)p[i]];
+        if (h == 0xFF) return false;
+        v = (v << 4) | h;
+    }
+    out = v;
+    return true;
+}
+
+static inline SlcanResult slcan_parse_line(const char* p, size_t n, SlcanFrame& f)
+{
+    if (n == 0) return SLCAN_IGNORED;
+
+    size_t id_len;
+    switch (p[0])
+    {
+        case 't': id_len = 3; f.extended = false; f.rtr = false; break;
+        case 'T': id_len = 8; f.extended = true; f.rtr = false; break;
+        case 'r': id_len = 3; f.extended = false; f.rtr = true; break;
+        case 'R': id_len = 8; f.extended = true; f.rtr = true; break;
+        case 'X': return SLCAN_IGNORED;
+        default: return SLCAN_MALFORMED;
+    }
+
+    size_t pos = 1;
+    if (n < pos + id_len + 1) return SLCAN_MALFORMED;
+    uint32_t id, dlc;
+    if (!slcan_hex(p + pos, id_len, id)) return SLCAN_MALFORMED;
+    pos += id_len;
+    if (!slcan_hex(p + pos, 1, dlc) || dlc > 8) return SLCAN_MALFORMED;
+    pos += 1;
+    if (f.extended ? id > 0x1FFFFFFF : id > 0x7FF) return SLCAN_MALFORMED;
+
+    f.id = id;
+    f.dlc = (uint8_t)dlc;
+
+    if (!f.rtr)
+    {
+        if (n < pos + 2 * dlc) return SLCAN_MALFORMED;
+        for (uint32_t i = 0; i < dlc; i++)
+        {
+            uint8_t hi = kSlcanHex.v[(uint8_t)p[pos]];
+            uint8_t lo = kSlcanHex.v[(uint8_t)p[pos + 1]];
+            if ((hi | lo) & 0xF0) return SLCAN_MALFORMED;
+            f.data[i] = (uint8_t)((hi << 4) | lo);
+            pos += 2;
+        }
+    }
+
+    f.timestamp_ms = -1;
+    if (n == pos) return SLCAN_FRAME;
+    uint32_t ts;
+    if (n != pos + 4 || !slcan_hex(p + pos, 4, ts) || ts >= 60000) return SLCAN_MALFORMED;
+    f.timestamp_ms = (int32_t)ts;
+    return SLCAN_FRAME;
+}
@@ -0,0 +1,373 @@
+// SPDX-License-Identifier: GPL-3.0-only
+//
+// slcandump: convert an SLCAN stream (tty, file or stdin) to candump, Vector ASC
+// or a compact binary log, and report timing gaps and malformed lines.
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "output.h"
+#include "slcan_parser.h"
+
+enum TimestampSource
+{
+    TS_AUTO, // device timestamp when the line has one, host time otherwise
+    TS_HOST,
+    TS_DEVICE,
+};
+
+struct Options
+{
+    const char* input = "-";
+    const char* output = "-";
+    const char* iface = "can0";
+    OutputFormat format = FORMAT_CANDUMP;
+    TimestampSource ts = TS_AUTO;
+    uint32_t gap_ms = 100;
+    bool check_seq = false;
+    bool verbose = false;
+};
+
+struct Stats
+{
+    uint64_t bytes = 0;
+    uint64_t lines = 0;
+    uint64_t frames = 0;
+    uint64_t ignored = 0;
+    uint64_t malformed = 0;
+    uint64_t gaps = 0;
+    uint64_t max_gap_us = 0;
+    uint64_t seq_breaks = 0;
+    uint64_t seq_lost = 0;
+};
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void on_signal(int)
+{
+    s_stop = 1;
+}
+
+static uint64_t now_us(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void usage(const char* prog)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [options]\n"
+                 "  -i PATH     input: tty, file or - for stdin (default -)\n"
+                 "  -o PATH     output file or - for stdout (default -)\n"
+                 "  -f FORMAT   candump | asc | bin (default candump)\n"
+                 "  -n IFACE    interface name in candump output (default can0)\n"
+                 "  -t SOURCE   timestamps: auto | host | device (default auto)\n"
+                 "  -g MS       report gaps between frames longer than MS (default 100, 0 = off)\n"
+                 "  -s          check self-test sequence numbers (first 4 data bytes)\n"
+                 "  -v          print each malformed line and gap to stderr\n",
+                 prog);
+}
+
+static bool parse_options(int argc, char** argv, Options& opt)
+{
+    int c;
+    while ((c = getopt(argc, argv, "i:o:f:n:t:g:svh")) != -1)
+    {
+        switch (c)
+        {
+            case 'i': opt.input = optarg; break;
+            case 'o': opt.output = optarg; break;
+            case 'n': opt.iface = optarg; break;
+            case 'f':
+                if (!std::strcmp(optarg, "candump")) opt.format = FORMAT_CANDUMP;
+                else if (!std::strcmp(optarg, "asc")) opt.format = FORMAT_ASC;
+                else if (!std::strcmp(optarg, "bin")) opt.format = FORMAT_BINARY;
+                else return false;
+                break;
+            case 't':
+                if (!std::strcmp(optarg, "auto")) opt.ts = TS_AUTO;
+                else if (!std::strcmp(optarg, "host")) opt.ts = TS_HOST;
+                else if (!std::strcmp(optarg, "device")) opt.ts = TS_DEVICE;
+                else return false;
+                break;
+            case 'g': opt.gap_ms = (uint32_t)std::strtoul(optarg, nullptr, 10); break;
+            case 's': opt.check_seq = true; break;
+            case 'v': opt.verbose = true; break;
+            default: return false;
+        }
+    }
+    return optind == argc;
+}
+
+static int open_input(const char* path)
+{
+    if (!std::strcmp(path, "-")) return STDIN_FILENO;
+    int fd = ::open(path, O_RDONLY | O_NOCTTY);
+    if (fd < 0) return -1;
+    if (isatty(fd))
+    {
+        // CDC-ACM ignores the baud rate; raw mode keeps the line discipline out of the way
+        struct termios tio;
+        if (tcgetattr(fd, &tio) == 0)
+        {
+            cfmakeraw(&tio);
+            tio.c_cc[VMIN] = 1;
+            tio.c_cc[VTIME] = 0;
+            tcsetattr(fd, TCSANOW, &tio);
+        }
+    }
+    return fd;
+}
+
+// Turns per-line results into frames with timestamps and keeps the statistics.
+class Converter
+{
+public:
+    Converter(const Options& opt, OutputWriter& out, Stats& stats) : opt_(opt), out_(out), stats_(stats) {}
+
+    void line(const char* p, size_t n, uint64_t host_us)
+    {
+        // BEL is the SLCAN error reply; it has no terminator of its own
+        while (n > 0 && p[0] == '\a')
+        {
+            p++;
+            n--;
+        }
+        stats_.lines++;
+
+        SlcanFrame f;
+        switch (slcan_parse_line(p, n, f))
+        {
+            case SLCAN_FRAME:
+                frame(f, host_us);
+                break;
+            case SLCAN_IGNORED:
+                stats_.ignored++;
+                break;
+            case SLCAN_MALFORMED:
+                stats_.malformed++;
+                if (opt_.verbose)
+                {
+                    std::fprintf(stderr, "malformed line %llu: %.*s\n", (unsigned long long)stats_.lines,
+                                 (int)(n > 64 ? 64 : n), p);
+                }
+                break;
+        }
+    }
+
+private:
+    uint64_t timestamp(const SlcanFrame& f, uint64_t host_us)
+    {
+        bool use_device = f.timestamp_ms >= 0 && opt_.ts != TS_HOST;
+        if (!use_device) return host_us;
+
+        // SLCAN timestamps are milliseconds wrapping at 60000; anchor them to host time
+        if (!have_device_ts_)
+        {
+            have_device_ts_ = true;
+            device_base_us_ = host_us;
+            device_first_ms_ = (uint32_t)f.timestamp_ms;
+            device_last_ms_ = device_first_ms_;
+        }
+        uint32_t ms = (uint32_t)f.timestamp_ms;
+        if (ms < device_last_ms_) device_wraps_++;
+        device_last_ms_ = ms;
+        uint64_t elapsed_ms = device_wraps_ * 60000ull + ms - device_first_ms_;
+        return device_base_us_ + elapsed_ms * 1000;
+    }
+
+    void frame(const SlcanFrame& f, uint64_t host_us)
+    {
+        if (opt_.ts == TS_DEVICE && f.timestamp_ms < 0)
+        {
+            stats_.malformed++;
+            return;
+        }
+        uint64_t ts = timestamp(f, host_us);
+        stats_.frames++;
+
+        if (have_last_ && opt_.gap_ms > 0 && ts > last_ts_)
+        {
+            uint64_t gap = ts - last_ts_;
+            if (gap > stats_.max_gap_us) stats_.max_gap_us = gap;
+            if (gap > (uint64_t)opt_.gap_ms * 1000)
+            {
+                stats_.gaps++;
+                if (opt_.verbose)
+                {
+                    std::fprintf(stderr, "gap of %.3f ms before frame %llu\n", gap / 1000.0,
+                                 (unsigned long long)stats_.frames);
+                }
+            }
+        }
+        have_last_ = true;
+        last_ts_ = ts;
+
+        if (opt_.check_seq && !f.rtr && f.dlc >= 4) check_seq(f);
+        out_.frame(f, ts);
+    }
+
+    void check_seq(const SlcanFrame& f)
+    {
+        uint32_t seq = ((uint32_t)f.data[0] << 24) | ((uint32_t)f.data[1] << 16) | ((uint32_t)f.data[2] << 8) |
+            f.data[3];
+        if (have_seq_ && seq != last_seq_ + 1)
+        {
+            stats_.seq_breaks++;
+            if (seq > last_seq_) stats_.seq_lost += seq - last_seq_ - 1;
+        }
+        have_seq_ = true;
+        last_seq_ = seq;
+    }
+
+    const Options& opt_;
+    OutputWriter& out_;
+    Stats& stats_;
+    bool have_last_ = false;
+    uint64_t last_ts_ = 0;
+    bool have_device_ts_ = false;
+    uint64_t device_base_us_ = 0;
+    uint32_t device_first_ms_ = 0;
+    uint32_t device_last_ms_ = 0;
+    uint64_t device_wraps_ = 0;
+    bool have_seq_ = false;
+    uint32_t last_seq_ = 0;
+};
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if (!parse_options(argc, argv, opt))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    int in_fd = open_input(opt.input);
+    if (in_fd < 0)
+    {
+        std::fprintf(stderr, "cannot open %s: %s\n", opt.input, std::strerror(errno));
+        return 1;
+    }
+    const bool live = isatty(in_fd);
+
+    int out_fd = STDOUT_FILENO;
+    if (std::strcmp(opt.output, "-") != 0)
+    {
+        out_fd = ::open(opt.output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out_fd < 0)
+        {
+            std::fprintf(stderr, "cannot open %s: %s\n", opt.output, std::strerror(errno));
+            return 1;
+        }
+    }
+
+    // No SA_RESTART: a blocking read() on the tty returns EINTR and we flush and exit
+    struct sigaction sa = {};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    Stats stats;
+    OutputWriter out(out_fd, opt.format, opt.iface);
+    Converter conv(opt, out, stats);
+
+    const uint64_t t0 = now_us(CLOCK_MONOTONIC);
+    out.begin(now_us(CLOCK_REALTIME));
+
+    static constexpr size_t kReadSize = 64 * 1024;
+    static constexpr size_t kMaxLine = 256; // longer lines are malformed anyway
+    static char buf[kReadSize + kMaxLine];
+    size_t carry = 0;
+    bool eof = false;
+
+    while (!s_stop)
+    {
+        ssize_t n = ::read(in_fd, buf + carry, kReadSize);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            std::fprintf(stderr, "read error: %s\n", std::strerror(errno));
+            break;
+        }
+        if (n == 0)
+        {
+            eof = true;
+            break;
+        }
+        stats.bytes += (uint64_t)n;
+
+        // One clock read per chunk; all lines in it share the host timestamp
+        const uint64_t host_us = now_us(CLOCK_REALTIME);
+        const char* p = buf;
+        const char* end = buf + carry + n;
+        const char* line = p;
+        for (; p < end; p++)
+        {
+            if (*p == '\r' || *p == '\n')
+            {
+                if (p > line) conv.line(line, (size_t)(p - line), host_us);
+                line = p + 1;
+            }
+        }
+
+        carry = (size_t)(end - line);
+        if (carry > kMaxLine)
+        {
+            stats.lines++;
+            stats.malformed++;
+            carry = 0;
+        }
+        else if (carry > 0)
+        {
+            std::memmove(buf, line, carry);
+        }
+
+        // Live input: hand the chunk on right away, still one write() per read()
+        if (live && !out.flush()) break;
+    }
+
+    // A final line without terminator: complete at end of input (e.g. a capture
+    // file cut after the last frame), cut short when interrupted or on error
+    if (carry > 0)
+    {
+        if (eof)
+        {
+            conv.line(buf, carry, now_us(CLOCK_REALTIME));
+        }
+        else
+        {
+            stats.lines++;
+            stats.malformed++;
+        }
+    }
+
+    out.end();
+    const double elapsed = (now_us(CLOCK_MONOTONIC) - t0) / 1e6;
+
+    std::fprintf(stderr,
+                 "slcandump: bytes=%llu lines=%llu frames=%llu ignored=%llu malformed=%llu "
+                 "gaps=%llu max_gap_ms=%.3f",
+                 (unsigned long long)stats.bytes, (unsigned long long)stats.lines,
+                 (unsigned long long)stats.frames, (unsigned long long)stats.ignored,
+                 (unsigned long long)stats.malformed, (unsigned long long)stats.gaps, stats.max_gap_us / 1000.0);
+    if (opt.check_seq)
+    {
+        std::fprintf(stderr, " seq_breaks=%llu seq_lost=%llu", (unsigned long long)stats.seq_breaks,
+                     (unsigned long long)stats.seq_lost);
+    }
+    std::fprintf(stderr, " elapsed=%.3fs rate=%.0f frames/s\n", elapsed, elapsed > 0 ? stats.frames / elapsed : 0.0);
+
+    if (in_fd != STDIN_FILENO) ::close(in_fd);
+    if (out_fd != STDOUT_FILENO) ::close(out_fd);
+    return 0;
+}